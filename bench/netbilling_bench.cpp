@@ -0,0 +1,500 @@
+// 后端基准测试：不依赖界面，生成合成数据后逐项计时，结果以 JSON 输出，
+// 便于不同版本之间对比吞吐量与峰值内存。
+//
+// 用法：netbilling_bench [--sizes 10000,1000000,10000000] [--work-dir DIR] [--output FILE]
+
+#include "backend/AccountDirectory.h"
+#include "backend/Billing.h"
+#include "backend/Csv.h"
+#include "backend/FeeKernel.h"
+#include "backend/Repository.h"
+#include "backend/Security.h"
+#include "backend/UsageStore.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QSemaphore>
+#include <QStringConverter>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <iterator>
+#include <unordered_map>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+    // 进程启动以来的常驻内存峰值，不会随某一轮结束而回落，各轮的值包含之前各轮的峰值
+    qint64 processPeakRssBytes()
+    {
+#if defined(Q_OS_WIN)
+        PROCESS_MEMORY_COUNTERS counters{};
+        if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+            return static_cast<qint64>(counters.PeakWorkingSetSize);
+        return -1;
+#else
+        rusage usage{};
+        if (getrusage(RUSAGE_SELF, &usage) != 0)
+            return -1;
+#if defined(Q_OS_MACOS)
+        return static_cast<qint64>(usage.ru_maxrss); // macOS 以字节为单位
+#else
+        return static_cast<qint64>(usage.ru_maxrss) * 1024; // Linux 以 KB 为单位
+#endif
+#endif
+    }
+
+    qint64 fileSize(const QString &path)
+    {
+        return QFileInfo(path).size();
+    }
+
+    // 计时一次操作；bytes 为 0 时不输出 MB/s
+    QJsonObject measure(const QString &name, qint64 rows, const std::function<bool()> &op, const std::function<qint64()> &bytes = {})
+    {
+        QElapsedTimer timer;
+        timer.start();
+        const bool ok = op();
+        const double seconds = static_cast<double>(timer.nsecsElapsed()) / 1e9;
+        const qint64 byteCount = bytes ? bytes() : 0;
+
+        QJsonObject result;
+        result.insert(QStringLiteral("name"), name);
+        result.insert(QStringLiteral("ok"), ok);
+        result.insert(QStringLiteral("seconds"), seconds);
+        result.insert(QStringLiteral("rows"), rows);
+        result.insert(QStringLiteral("rowsPerSec"), seconds > 0 ? static_cast<double>(rows) / seconds : 0.0);
+        if (byteCount > 0)
+        {
+            result.insert(QStringLiteral("bytes"), byteCount);
+            result.insert(QStringLiteral("mbPerSec"), seconds > 0 ? static_cast<double>(byteCount) / (1024.0 * 1024.0) / seconds : 0.0);
+        }
+        std::fprintf(stderr, "  %-28s %10.3f s  %s\n", qPrintable(name), seconds, ok ? "" : "FAILED");
+        return result;
+    }
+
+    // 在全局线程池中执行 task(0..count-1) 并等待这些任务结束，不等待池中其他任务
+    void runOnGlobalPool(std::size_t count, const std::function<void(std::size_t)> &task)
+    {
+        QSemaphore finished;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            QThreadPool::globalInstance()->start([&, i]()
+                                                 {
+                task(i);
+                finished.release(); });
+        }
+        finished.acquire(static_cast<int>(count));
+    }
+
+    // 按账号哈希分片的并行月结原型：各分片在全局线程池中独立汇总、计费并排序，最后归并。
+    // 应用按增量维护的 UsageStore 结算，不走这条路径；这里只用来衡量分片汇总能否随核数扩展，
+    // 结果须与串行的 BillingEngine::computeMonthly 逐行一致
+    std::vector<BillLine> computeMonthlySharded(int year, int month, const std::vector<User> &users,
+                                                const std::vector<Session> &sessions)
+    {
+        const std::size_t shards = static_cast<std::size_t>(std::max(1, QThreadPool::globalInstance()->maxThreadCount()));
+        if (shards == 1 || sessions.size() < shards)
+            return BillingEngine::computeMonthly(year, month, users, sessions);
+        const auto shardOf = [shards](const QString &account)
+        { return static_cast<std::uint16_t>(qHash(account) % shards); };
+
+        // 第一阶段：按会话区间切块，并行算出每条会话所属的分片
+        std::vector<std::uint16_t> shardOfSession(sessions.size());
+        const std::size_t chunkSize = (sessions.size() + shards - 1) / shards;
+        runOnGlobalPool(shards, [&](std::size_t chunk)
+                        {
+            const std::size_t to = std::min(sessions.size(), (chunk + 1) * chunkSize);
+            for (std::size_t i = chunk * chunkSize; i < to; ++i)
+                shardOfSession[i] = shardOf(sessions[i].account); });
+
+        // 第二阶段：每个分片只取自己的用户与会话，按列式路径汇总，互不加锁；
+        // 同一账号总落在同一分片，重复账号以后出现者为准的规则不变
+        std::vector<std::vector<BillLine>> parts(shards);
+        runOnGlobalPool(shards, [&](std::size_t shard)
+                        {
+            std::vector<User> shardUsers;
+            for (const auto &user : users)
+            {
+                if (shardOf(user.account) == shard)
+                    shardUsers.push_back(user);
+            }
+            SessionColumns columns;
+            std::unordered_map<QString, std::uint32_t> indexOf;
+            for (std::size_t i = 0; i < sessions.size(); ++i)
+            {
+                if (shardOfSession[i] != shard)
+                    continue;
+                const Session &s = sessions[i];
+                auto [it, inserted] = indexOf.try_emplace(s.account, static_cast<std::uint32_t>(columns.accounts.size()));
+                if (inserted)
+                    columns.accounts.push_back(s.account);
+                columns.accountIndex.push_back(it->second);
+                columns.beginSecs.push_back(beginSecsOf(s.begin));
+                columns.endSecs.push_back(endSecsOf(s.end));
+            }
+            parts[shard] = BillingEngine::computeMonthly(year, month, shardUsers, columns); });
+
+        // 归并各分片的有序结果
+        std::vector<BillLine> out;
+        std::vector<std::size_t> bounds{0};
+        for (auto &part : parts)
+        {
+            out.insert(out.end(), std::make_move_iterator(part.begin()), std::make_move_iterator(part.end()));
+            bounds.push_back(out.size());
+        }
+        const auto byAccount = [](const BillLine &a, const BillLine &b)
+        { return a.account < b.account; };
+        for (std::size_t width = 1; width < shards; width *= 2)
+        {
+            for (std::size_t i = 0; i + width < shards; i += 2 * width)
+            {
+                const auto begin = out.begin() + static_cast<std::ptrdiff_t>(bounds[i]);
+                const auto middle = out.begin() + static_cast<std::ptrdiff_t>(bounds[i + width]);
+                const auto end = out.begin() + static_cast<std::ptrdiff_t>(bounds[std::min(i + 2 * width, shards)]);
+                std::inplace_merge(begin, middle, end, byAccount);
+            }
+        }
+        return out;
+    }
+
+    QString accountFor(qint64 index)
+    {
+        return QStringLiteral("u%1").arg(index, 8, 10, QLatin1Char('0'));
+    }
+
+    std::vector<User> makeUsers(qint64 count, const QString &passwordHash)
+    {
+        std::vector<User> users;
+        users.reserve(static_cast<std::size_t>(count));
+        auto *rng = QRandomGenerator::global();
+        for (qint64 i = 0; i < count; ++i)
+        {
+            User user;
+            user.account = accountFor(i);
+            user.name = QStringLiteral(u"用户%1").arg(i);
+            user.plan = static_cast<Tariff>(rng->bounded(5));
+            user.passwordHash = passwordHash;
+            user.role = UserRole::User;
+            user.enabled = true;
+            user.balance = Money::fromCents(rng->bounded(100000));
+            users.push_back(std::move(user));
+        }
+        return users;
+    }
+
+    // 会话集中在同一年内，约 5% 为 10 小时以上的长会话，其中部分跨越月末
+    std::vector<Session> makeSessions(qint64 count, qint64 userCount, int year)
+    {
+        std::vector<Session> sessions;
+        sessions.reserve(static_cast<std::size_t>(count));
+        auto *rng = QRandomGenerator::global();
+        const QDateTime yearStart(QDate(year, 1, 1), QTime(0, 0, 0));
+        const qint64 startSecs = yearStart.toSecsSinceEpoch();
+        const qint64 yearSecs = static_cast<qint64>(QDate(year, 1, 1).daysInYear()) * 86400;
+        for (qint64 i = 0; i < count; ++i)
+        {
+            const qint64 begin = startSecs + static_cast<qint64>(rng->bounded(static_cast<quint64>(yearSecs)));
+            const qint64 duration = rng->bounded(20) == 0 ? 60 * (600 + rng->bounded(4000)) : 60 * (1 + rng->bounded(600));
+            sessions.push_back(Session{accountFor(static_cast<qint64>(rng->bounded(static_cast<quint64>(userCount)))),
+                                       QDateTime::fromSecsSinceEpoch(begin),
+                                       QDateTime::fromSecsSinceEpoch(begin + duration)});
+        }
+        return sessions;
+    }
+
+    QJsonObject runSize(qint64 rows, const QString &workDir)
+    {
+        std::fprintf(stderr, "rows = %lld\n", static_cast<long long>(rows));
+        const QString baseDir = QDir(workDir).filePath(QStringLiteral("rows_%1").arg(rows));
+        const QString dataDir = QDir(baseDir).filePath(QStringLiteral("data"));
+        const QString outDir = QDir(baseDir).filePath(QStringLiteral("out"));
+        const QString restoreDir = QDir(baseDir).filePath(QStringLiteral("restore"));
+        const QString backupPath = QDir(baseDir).filePath(QStringLiteral("backup.nbk"));
+        QDir(baseDir).removeRecursively();
+        QDir().mkpath(dataDir);
+        QDir().mkpath(outDir);
+
+        constexpr int kYear = 2024;
+        const std::vector<User> users = makeUsers(rows, Security::hashPassword(QStringLiteral("123456")));
+        std::vector<Session> sessions = makeSessions(rows, rows, kYear);
+
+        Repository repository(dataDir, outDir);
+        QJsonArray benchmarks;
+
+        benchmarks.append(measure(QStringLiteral("Repository::saveUsers"), rows, [&]
+                                  { return repository.saveUsers(users); },
+                                  [&]
+                                  { return fileSize(repository.usersPath()); }));
+        benchmarks.append(measure(QStringLiteral("Repository::saveSessions"), rows, [&]
+                                  { return repository.saveSessions(sessions); },
+                                  [&]
+                                  { return fileSize(repository.sessionsPath()); }));
+        // 之后的加载、汇总与备份都读取这两个文件，写入失败时其余计时没有意义
+        const auto succeeded = [&](qsizetype index)
+        { return benchmarks.at(index).toObject().value(QStringLiteral("ok")).toBool(); };
+        if (!succeeded(0) || !succeeded(1))
+        {
+            QJsonObject result;
+            result.insert(QStringLiteral("rows"), rows);
+            result.insert(QStringLiteral("benchmarks"), benchmarks);
+            result.insert(QStringLiteral("error"), QStringLiteral("failed to write users.csv or sessions.csv"));
+            QDir(baseDir).removeRecursively();
+            return result;
+        }
+        sessions.clear();
+        sessions.shrink_to_fit();
+
+        std::vector<User> loadedUsers;
+        benchmarks.append(measure(QStringLiteral("Repository::loadUsers"), rows, [&]
+                                  {
+            loadedUsers = repository.loadUsers();
+            return static_cast<qint64>(loadedUsers.size()) == rows; },
+                                  [&]
+                                  { return fileSize(repository.usersPath()); }));
+
+        // saveSessions 同时写出二进制快照，先测快照路径，删除快照后再测 CSV 路径
+        benchmarks.append(measure(QStringLiteral("Repository::loadSessionColumns(nbs)"), rows, [&]
+                                  { return static_cast<qint64>(repository.loadSessionColumns().size()) == rows; },
+                                  [&]
+                                  { return fileSize(repository.sessionsBinaryPath()); }));
+
+        std::vector<Session> loadedSessions;
+        benchmarks.append(measure(QStringLiteral("Repository::loadSessions(nbs)"), rows, [&]
+                                  {
+            loadedSessions = repository.loadSessions();
+            return static_cast<qint64>(loadedSessions.size()) == rows; },
+                                  [&]
+                                  { return fileSize(repository.sessionsBinaryPath()); }));
+
+        QFile::remove(repository.sessionsBinaryPath());
+        benchmarks.append(measure(QStringLiteral("Repository::loadSessions(csv)"), rows, [&]
+                                  {
+            loadedSessions = repository.loadSessions();
+            return static_cast<qint64>(loadedSessions.size()) == rows; },
+                                  [&]
+                                  { return fileSize(repository.sessionsPath()); }));
+
+        {
+            QStringList lines;
+            QFile file(repository.sessionsPath());
+            if (file.open(QIODevice::ReadOnly | QIODevice::Text))
+            {
+                QTextStream in(&file);
+                in.setEncoding(QStringConverter::Utf8);
+                QString line;
+                while (in.readLineInto(&line))
+                    lines.append(line);
+            }
+            qint64 bytes = 0;
+            for (const auto &line : lines)
+                bytes += line.size();
+            benchmarks.append(measure(QStringLiteral("Csv::parseLine"), lines.size(), [&]
+                                      {
+                qint64 fields = 0;
+                for (const auto &line : lines)
+                    fields += Csv::parseLine(line).size();
+                return fields == static_cast<qint64>(lines.size()) * 3; },
+                                      [&]
+                                      { return bytes; }));
+        }
+
+        std::vector<BillLine> serialLines;
+        benchmarks.append(measure(QStringLiteral("BillingEngine::computeMonthly"), rows, [&]
+                                  {
+            serialLines = BillingEngine::computeMonthly(kYear, 6, loadedUsers, loadedSessions);
+            return serialLines.size() == loadedUsers.size(); }));
+        // 月末整体结算的分片并行原型：与串行结果逐行比较
+        benchmarks.append(measure(QStringLiteral("computeMonthlySharded"), rows, [&]
+                                  {
+            const auto lines = computeMonthlySharded(kYear, 6, loadedUsers, loadedSessions);
+            return std::equal(lines.begin(), lines.end(), serialLines.begin(), serialLines.end(),
+                              [](const BillLine &a, const BillLine &b)
+                              { return a.account == b.account && a.minutes == b.minutes && a.amount == b.amount; }); }));
+        serialLines.clear();
+        serialLines.shrink_to_fit();
+        loadedSessions.clear();
+        loadedSessions.shrink_to_fit();
+
+        // 会话已释放，峰值内存只受用户数与读块大小影响
+        benchmarks.append(measure(QStringLiteral("Repository::computeMonthlyStreaming"), rows, [&]
+                                  {
+            const auto lines = repository.computeMonthlyStreaming(kYear, 6, loadedUsers);
+            return lines.size() == loadedUsers.size(); },
+                                  [&]
+                                  { return fileSize(repository.sessionsPath()); }));
+        // 会话中的账号大小写与用户表不一致时，流式汇总须与界面使用的 UsageStore 结算逐行相同
+        {
+            const qint64 mixedRows = std::min<qint64>(rows, 10000);
+            const std::vector<User> mixedUsers(loadedUsers.begin(), loadedUsers.begin() + mixedRows);
+            std::vector<Session> mixedSessions = makeSessions(mixedRows, mixedRows, kYear);
+            for (std::size_t i = 1; i < mixedSessions.size(); i += 2)
+                mixedSessions[i].account = mixedSessions[i].account.toUpper();
+            Repository mixed(QDir(baseDir).filePath(QStringLiteral("mixed")), outDir);
+            benchmarks.append(measure(QStringLiteral("computeMonthlyStreaming(mixed case)"), mixedRows, [&]
+                                      {
+                if (!mixed.saveSessions(mixedSessions))
+                    return false;
+                AccountDirectory accounts;
+                for (const auto &user : mixedUsers)
+                    accounts.intern(user.account);
+                for (auto &session : mixedSessions)
+                    session.accountId = accounts.intern(session.account);
+                UsageStore usage;
+                usage.rebuild(mixedSessions);
+                const auto expected = BillingEngine::computeMonthly(kYear, 6, mixedUsers, accounts, usage);
+                const auto sameLines = [&](const std::vector<BillLine> &lines)
+                {
+                    return std::equal(lines.begin(), lines.end(), expected.begin(), expected.end(),
+                                      [](const BillLine &a, const BillLine &b)
+                                      { return a.account == b.account && a.minutes == b.minutes && a.amount == b.amount; });
+                };
+                // 先走二进制快照，删除快照后再走 CSV
+                if (!sameLines(mixed.computeMonthlyStreaming(kYear, 6, mixedUsers)))
+                    return false;
+                QFile::remove(mixed.sessionsBinaryPath());
+                return sameLines(mixed.computeMonthlyStreaming(kYear, 6, mixedUsers)); }));
+        }
+        loadedUsers.clear();
+        loadedUsers.shrink_to_fit();
+
+        // 开学集中充值：整批追加只打开一次 bills.csv
+        std::vector<RechargeRecord> recharges;
+        recharges.reserve(users.size());
+        const QDateTime rechargeTime = QDateTime::currentDateTime();
+        for (const auto &user : users)
+            recharges.push_back(RechargeRecord{user.account, rechargeTime, Money::fromCents(5000), QStringLiteral("admin"),
+                                               QStringLiteral(u"开学充值"), user.balance + Money::fromCents(5000)});
+        benchmarks.append(measure(QStringLiteral("Repository::appendRechargeRecords"), rows, [&]
+                                  { return repository.appendRechargeRecords(recharges); },
+                                  [&]
+                                  { return fileSize(repository.billsPath()); }));
+        recharges.clear();
+        recharges.shrink_to_fit();
+
+        QString error;
+        benchmarks.append(measure(QStringLiteral("Repository::exportBackup"), rows, [&]
+                                  { return repository.exportBackup(backupPath, &error); },
+                                  [&]
+                                  { return fileSize(backupPath); }));
+
+        const QString compressedPath = QDir(baseDir).filePath(QStringLiteral("backup-compressed.nbk"));
+        BackupStats compressedStats;
+        benchmarks.append(measure(QStringLiteral("Repository::exportBackup(zlib 6)"), rows, [&]
+                                  { return repository.exportBackup(compressedPath, &error, 6, &compressedStats); },
+                                  [&]
+                                  { return fileSize(compressedPath); }));
+
+        // 数据未变时增量备份只写清单
+        const QString incrementalPath = QDir(baseDir).filePath(QStringLiteral("backup-incremental.nbk"));
+        benchmarks.append(measure(QStringLiteral("Repository::exportIncrementalBackup"), rows, [&]
+                                  { return repository.exportIncrementalBackup(incrementalPath, backupPath, &error); },
+                                  [&]
+                                  { return fileSize(incrementalPath); }));
+
+        Repository restore(restoreDir, outDir);
+        benchmarks.append(measure(QStringLiteral("Repository::importBackup"), rows, [&]
+                                  { return restore.importBackup(backupPath, &error); },
+                                  [&]
+                                  { return fileSize(backupPath); }));
+
+        QJsonObject result;
+        result.insert(QStringLiteral("rows"), rows);
+        result.insert(QStringLiteral("benchmarks"), benchmarks);
+        result.insert(QStringLiteral("processPeakRssBytesSoFar"), processPeakRssBytes());
+        result.insert(QStringLiteral("backupCompressionRatio"), compressedStats.ratio());
+        result.insert(QStringLiteral("backupCompressionMBps"), compressedStats.megabytesPerSecond());
+        if (!error.isEmpty())
+            result.insert(QStringLiteral("error"), error);
+
+        QDir(baseDir).removeRecursively();
+        return result;
+    }
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("netbilling_bench"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("NetBilling backend benchmarks"));
+    parser.addHelpOption();
+    const QCommandLineOption sizesOption(QStringLiteral("sizes"),
+                                         QStringLiteral("Comma separated row counts."),
+                                         QStringLiteral("list"),
+                                         QStringLiteral("10000,1000000,10000000"));
+    const QCommandLineOption workDirOption(QStringLiteral("work-dir"),
+                                           QStringLiteral("Directory for generated data (default: a temporary directory)."),
+                                           QStringLiteral("dir"));
+    const QCommandLineOption outputOption(QStringLiteral("output"),
+                                          QStringLiteral("Write the JSON report to this file instead of stdout."),
+                                          QStringLiteral("file"));
+    parser.addOptions({sizesOption, workDirOption, outputOption});
+    parser.process(app);
+
+    QTemporaryDir tempDir;
+    const QString workDir = parser.isSet(workDirOption) ? parser.value(workDirOption) : tempDir.path();
+
+    QJsonArray runs;
+    bool failed = false;
+    for (const QString &token : parser.value(sizesOption).split(QLatin1Char(','), Qt::SkipEmptyParts))
+    {
+        bool ok = false;
+        const qint64 rows = token.trimmed().toLongLong(&ok);
+        if (!ok || rows <= 0)
+        {
+            std::fprintf(stderr, "invalid size: %s\n", qPrintable(token));
+            return 2;
+        }
+        const QJsonObject run = runSize(rows, workDir);
+        failed = failed || run.contains(QStringLiteral("error"));
+        runs.append(run);
+    }
+
+    QJsonObject report;
+    report.insert(QStringLiteral("version"), 1);
+    report.insert(QStringLiteral("createdAt"), QDateTime::currentDateTimeUtc().toString(Qt::ISODate));
+    report.insert(QStringLiteral("qt"), QString::fromLatin1(qVersion()));
+    report.insert(QStringLiteral("simd"), QString::fromLatin1(FeeKernel::isaName(FeeKernel::bestIsa())));
+    report.insert(QStringLiteral("threads"), QThread::idealThreadCount());
+    report.insert(QStringLiteral("runs"), runs);
+    report.insert(QStringLiteral("processPeakRssBytes"), processPeakRssBytes());
+
+    const QByteArray json = QJsonDocument(report).toJson(QJsonDocument::Indented);
+    if (parser.isSet(outputOption))
+    {
+        QFile out(parser.value(outputOption));
+        if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate) || out.write(json) != json.size())
+        {
+            std::fprintf(stderr, "cannot write %s\n", qPrintable(parser.value(outputOption)));
+            return 1;
+        }
+    }
+    else
+    {
+        std::fwrite(json.constData(), 1, static_cast<std::size_t>(json.size()), stdout);
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,25 @@
+#include "backend/AccountDirectory.h"
+
+AccountId AccountDirectory::intern(const QString &account)
+{
+    const QString key = foldKey(account);
+    const auto it = m_ids.constFind(key);
+    if (it != m_ids.constEnd())
+        return it.value();
+
+    const auto id = static_cast<AccountId>(m_accounts.size());
+    m_ids.insert(key, id);
+    m_accounts.push_back(account);
+    return id;
+}
+
+AccountId AccountDirectory::find(const QString &account) const
+{
+    return m_ids.value(foldKey(account), kInvalidAccountId);
+}
+
+void AccountDirectory::clear()
+{
+    m_ids.clear();
+    m_accounts.clear();
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "backend/Models.h"
+
+#include <QHash>
+
+// 账号驻留表：按大小写折叠后的键把账号映射为从 0 开始的稠密编号，
+// 之后的查找与汇总都可以直接按编号做数组下标
+class AccountDirectory
+{
+public:
+    AccountId intern(const QString &account);
+    AccountId find(const QString &account) const;
+    // 首次登记时的原始写法
+    const QString &account(AccountId id) const { return m_accounts[id]; }
+    std::size_t size() const { return m_accounts.size(); }
+    void clear();
+
+    static QString foldKey(const QString &account) { return account.toCaseFolded(); }
+
+private:
+    QHash<QString, AccountId> m_ids;
+    std::vector<QString> m_accounts;
+};
@@ -0,0 +1,207 @@
+#include "backend/AsyncRepository.h"
+
+#include <QPromise>
+
+#include <algorithm>
+#include <utility>
+
+AsyncRepository::AsyncRepository(Repository repository, int threadCount)
+    : m_repository(std::move(repository))
+{
+    m_pool.setMaxThreadCount(std::max(1, threadCount));
+}
+
+AsyncRepository::~AsyncRepository()
+{
+    m_pool.waitForDone();
+}
+
+template <typename T, typename Work>
+QFuture<T> AsyncRepository::run(const QString &writeKey, Work work)
+{
+    // QPromise 只能移动，放在共享指针里才能装进 std::function
+    auto promise = std::make_shared<QPromise<T>>();
+    QFuture<T> future = promise->future();
+    std::function<void()> job = [promise, work = std::move(work)]() mutable
+    {
+        promise->start();
+        if (!promise->isCanceled())
+            promise->addResult(work(*promise));
+        promise->finish();
+    };
+
+    if (writeKey.isEmpty())
+        m_pool.start(std::move(job));
+    else
+        enqueueWrite(writeKey, std::move(job));
+    return future;
+}
+
+void AsyncRepository::enqueueWrite(const QString &writeKey, std::function<void()> job)
+{
+    std::shared_ptr<WriteQueue> queue;
+    {
+        std::lock_guard<std::mutex> lock(m_queuesMutex);
+        std::shared_ptr<WriteQueue> &slot = m_writeQueues[writeKey];
+        if (!slot)
+            slot = std::make_shared<WriteQueue>();
+        queue = slot;
+    }
+
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    queue->pending.push_back(std::move(job));
+    if (queue->running)
+        return;
+
+    // 每个文件同一时刻至多一个线程在执行其队列，执行完已排队的任务后退出
+    queue->running = true;
+    m_pool.start([queue]()
+                 {
+        while (true)
+        {
+            std::function<void()> next;
+            {
+                std::lock_guard<std::mutex> lock(queue->mutex);
+                if (queue->pending.empty())
+                {
+                    queue->running = false;
+                    return;
+                }
+                next = std::move(queue->pending.front());
+                queue->pending.pop_front();
+            }
+            next();
+        } });
+}
+
+QFuture<std::vector<User>> AsyncRepository::loadUsers()
+{
+    return run<std::vector<User>>(QString(), [repository = m_repository](QPromise<std::vector<User>> &)
+                                  { return repository.loadUsers(); });
+}
+
+QFuture<std::vector<Session>> AsyncRepository::loadSessions(QDate fromMonth)
+{
+    return run<std::vector<Session>>(QString(), [repository = m_repository, fromMonth](QPromise<std::vector<Session>> &)
+                                     { return fromMonth.isValid() ? repository.loadSessions(fromMonth) : repository.loadSessions(); });
+}
+
+QFuture<std::vector<RechargeRecord>> AsyncRepository::loadRechargeRecords()
+{
+    return run<std::vector<RechargeRecord>>(QString(), [repository = m_repository](QPromise<std::vector<RechargeRecord>> &)
+                                            { return repository.loadRechargeRecords(); });
+}
+
+QFuture<RepositoryResult> AsyncRepository::saveUsers(std::vector<User> users)
+{
+    return run<RepositoryResult>(m_repository.usersPath(), [repository = m_repository, users = std::move(users)](QPromise<RepositoryResult> &)
+                                 {
+        RepositoryResult result;
+        result.ok = repository.saveUsers(users);
+        if (!result.ok)
+            result.error = QStringLiteral(u"保存用户数据失败。");
+        return result; });
+}
+
+QFuture<RepositoryResult> AsyncRepository::saveSessions(std::vector<Session> sessions)
+{
+    return run<RepositoryResult>(m_repository.sessionsPath(), [repository = m_repository, sessions = std::move(sessions)](QPromise<RepositoryResult> &)
+                                 {
+        RepositoryResult result;
+        result.ok = repository.saveSessions(sessions);
+        if (!result.ok)
+            result.error = QStringLiteral(u"保存上网记录失败。");
+        return result; });
+}
+
+QFuture<RepositoryResult> AsyncRepository::saveRechargeRecords(std::vector<RechargeRecord> records)
+{
+    return run<RepositoryResult>(m_repository.billsPath(), [repository = m_repository, records = std::move(records)](QPromise<RepositoryResult> &)
+                                 {
+        RepositoryResult result;
+        result.ok = repository.saveRechargeRecords(records);
+        if (!result.ok)
+            result.error = QStringLiteral(u"写入充值流水失败，请检查数据目录权限。");
+        return result; });
+}
+
+QFuture<RepositoryResult> AsyncRepository::appendRechargeRecord(RechargeRecord record)
+{
+    return run<RepositoryResult>(m_repository.billsPath(), [repository = m_repository, record = std::move(record)](QPromise<RepositoryResult> &)
+                                 {
+        RepositoryResult result;
+        result.ok = repository.appendRechargeRecord(record);
+        if (!result.ok)
+            result.error = QStringLiteral(u"记录充值流水失败，请检查数据目录权限。");
+        return result; });
+}
+
+QFuture<RepositoryResult> AsyncRepository::appendRechargeRecords(std::vector<RechargeRecord> records)
+{
+    return run<RepositoryResult>(m_repository.billsPath(), [repository = m_repository, records = std::move(records)](QPromise<RepositoryResult> &)
+                                 {
+        RepositoryResult result;
+        result.ok = repository.appendRechargeRecords(records);
+        if (!result.ok)
+            result.error = QStringLiteral(u"记录充值流水失败，请检查数据目录权限。");
+        return result; });
+}
+
+QFuture<RepositoryResult> AsyncRepository::writeMonthlyBill(int year, int month, std::vector<BillLine> lines)
+{
+    return run<RepositoryResult>(billKey(year, month), [repository = m_repository, year, month, lines = std::move(lines)](QPromise<RepositoryResult> &)
+                                 {
+        RepositoryResult result;
+        result.ok = repository.writeMonthlyBill(year, month, lines);
+        if (!result.ok)
+            result.error = QStringLiteral(u"写入账单文件失败，请检查目录权限。");
+        return result; });
+}
+
+QFuture<RepositoryResult> AsyncRepository::exportArchivedBill(int year, int month, std::vector<User> users)
+{
+    return run<RepositoryResult>(billKey(year, month), [repository = m_repository, year, month, users = std::move(users)](QPromise<RepositoryResult> &)
+                                 {
+        RepositoryResult result;
+        const std::vector<BillLine> lines = repository.computeMonthlyStreaming(year, month, users, 4 * 1024 * 1024, &result.error);
+        if (!result.error.isEmpty())
+            return result;
+        result.ok = repository.writeMonthlyBill(year, month, lines);
+        if (!result.ok)
+            result.error = QStringLiteral(u"写入账单文件失败，请检查目录权限。");
+        return result; });
+}
+
+QFuture<RepositoryResult> AsyncRepository::exportBackup(QString filePath, QString basePath, int compressionLevel)
+{
+    const QString key = filePath;
+    return run<RepositoryResult>(key, [repository = m_repository, filePath = std::move(filePath), basePath = std::move(basePath), compressionLevel](QPromise<RepositoryResult> &promise)
+                                 {
+        qint64 rangeKiB = -1;
+        const BackupProgress progress = [&](qint64 doneBytes, qint64 totalBytes)
+        {
+            if (totalBytes / 1024 != rangeKiB)
+            {
+                rangeKiB = totalBytes / 1024;
+                promise.setProgressRange(0, static_cast<int>(rangeKiB));
+            }
+            promise.setProgressValue(static_cast<int>(doneBytes / 1024));
+            return !promise.isCanceled();
+        };
+
+        RepositoryResult result;
+        result.ok = basePath.isEmpty()
+                        ? repository.exportBackup(filePath, &result.error, compressionLevel, &result.stats, progress)
+                        : repository.exportIncrementalBackup(filePath, basePath, &result.error, compressionLevel, &result.stats, progress);
+        return result; });
+}
+
+QString AsyncRepository::billKey(int year, int month) const
+{
+    return QStringLiteral("%1/bill_%2_%3").arg(m_repository.outputDir()).arg(year).arg(month);
+}
+
+void AsyncRepository::waitForDone()
+{
+    m_pool.waitForDone();
+}
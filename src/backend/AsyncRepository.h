@@ -0,0 +1,73 @@
+#pragma once
+
+#include "backend/Repository.h"
+
+#include <QFuture>
+#include <QHash>
+#include <QString>
+#include <QThreadPool>
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// 异步写操作的结果；error 仅在失败时填写，stats 仅由导出备份填写
+struct RepositoryResult
+{
+    bool ok{false};
+    QString error;
+    BackupStats stats;
+};
+
+// Repository 的异步外观：I/O 在专用线程池中执行并返回 QFuture，界面线程通过 QFutureWatcher 接收结果。
+// 读操作之间可以并发；写同一文件的操作按提交顺序串行执行，写不同文件的操作互不等待。
+// 尚未开始的任务被取消（QFuture::cancel）后直接跳过；导出备份在执行中也会响应取消，
+// 并以 KiB 为单位通过 QFuture 报告进度
+class AsyncRepository
+{
+public:
+    explicit AsyncRepository(Repository repository, int threadCount = 4);
+    ~AsyncRepository();
+    AsyncRepository(const AsyncRepository &) = delete;
+    AsyncRepository &operator=(const AsyncRepository &) = delete;
+
+    QFuture<std::vector<User>> loadUsers();
+    // fromMonth 有效时只读取与该月及之后有交集的会话（见 Repository::loadSessions）
+    QFuture<std::vector<Session>> loadSessions(QDate fromMonth = QDate());
+    QFuture<std::vector<RechargeRecord>> loadRechargeRecords();
+
+    QFuture<RepositoryResult> saveUsers(std::vector<User> users);
+    QFuture<RepositoryResult> saveSessions(std::vector<Session> sessions);
+    QFuture<RepositoryResult> saveRechargeRecords(std::vector<RechargeRecord> records);
+    QFuture<RepositoryResult> appendRechargeRecord(RechargeRecord record);
+    QFuture<RepositoryResult> appendRechargeRecords(std::vector<RechargeRecord> records);
+    QFuture<RepositoryResult> writeMonthlyBill(int year, int month, std::vector<BillLine> lines);
+    // 不加载会话，直接由磁盘上的会话文件流式汇总指定月份并写出账单，用于已结算的历史月份
+    QFuture<RepositoryResult> exportArchivedBill(int year, int month, std::vector<User> users);
+    // basePath 为空时导出全量备份，否则以其为基准导出增量备份
+    QFuture<RepositoryResult> exportBackup(QString filePath, QString basePath, int compressionLevel);
+
+    // 等待已提交的全部任务完成，之后可以安全地在调用线程中直接使用 Repository
+    void waitForDone();
+    const Repository &repository() const { return m_repository; }
+
+private:
+    struct WriteQueue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> pending;
+        bool running{false};
+    };
+
+    template <typename T, typename Work>
+    QFuture<T> run(const QString &writeKey, Work work);
+    void enqueueWrite(const QString &writeKey, std::function<void()> job);
+    QString billKey(int year, int month) const;
+
+    Repository m_repository;
+    QThreadPool m_pool;
+    std::mutex m_queuesMutex;
+    QHash<QString, std::shared_ptr<WriteQueue>> m_writeQueues;
+};
@@ -0,0 +1,414 @@
+#include "backend/Csv.h"
+
+#include "backend/Timestamp.h"
+
+#include <QDateTime>
+#include <QIODevice>
+#include <QTextStream>
+
+#include <limits>
+
+namespace Csv
+{
+QStringList parseLine(const QString &line)
+{
+    QStringList fields;
+    QString current;
+    bool inQuotes = false;
+    for (int i = 0; i < line.size(); ++i)
+    {
+        const QChar ch = line.at(i);
+        if (inQuotes)
+        {
+            if (ch == QLatin1Char('"'))
+            {
+                if (i + 1 < line.size() && line.at(i + 1) == QLatin1Char('"'))
+                {
+                    current.append(QLatin1Char('"'));
+                    ++i;
+                }
+                else
+                {
+                    inQuotes = false;
+                }
+            }
+            else
+            {
+                current.append(ch);
+            }
+        }
+        else
+        {
+            if (ch == QLatin1Char('"'))
+            {
+                inQuotes = true;
+            }
+            else if (ch == QLatin1Char(','))
+            {
+                fields.append(current);
+                current.clear();
+            }
+            else
+            {
+                current.append(ch);
+            }
+        }
+    }
+    fields.append(current);
+    return fields;
+}
+
+QString encodeField(const QString &field)
+{
+    QString result = field;
+    bool needsQuotes = result.contains(QLatin1Char(',')) || result.contains(QLatin1Char('\n')) || result.contains(QLatin1Char('\r'));
+    if (result.contains(QLatin1Char('"')))
+    {
+        result.replace(QLatin1Char('"'), QString(2, QLatin1Char('"')));
+        needsQuotes = true;
+    }
+    if (needsQuotes)
+        return QStringLiteral("\"%1\"").arg(result);
+    return result;
+}
+
+void writeRow(QTextStream &out, const QStringList &fields)
+{
+    QStringList encoded;
+    encoded.reserve(fields.size());
+    for (const auto &field : fields)
+        encoded.append(encodeField(field));
+    out << encoded.join(QLatin1Char(',')) << QLatin1Char('\n');
+}
+
+Writer::Writer(QIODevice *device, qsizetype blockBytes)
+    : m_device(device), m_buffer(std::max<qsizetype>(blockBytes, 64), Qt::Uninitialized)
+{
+}
+
+Writer &Writer::field(QStringView text)
+{
+    separator();
+    bool needsQuotes = false;
+    for (const QChar ch : text)
+    {
+        const char16_t unit = ch.unicode();
+        if (unit == u',' || unit == u'"' || unit == u'\n' || unit == u'\r')
+        {
+            needsQuotes = true;
+            break;
+        }
+    }
+
+    // 每个 UTF-16 单元至多编码为 3 个字节（代理对共 4 个），引号翻倍后也不超过这个上限
+    char *out = reserve(text.size() * 3 + 2);
+    char *p = out;
+    if (needsQuotes)
+        *p++ = '"';
+    const char16_t *units = text.utf16();
+    const qsizetype size = text.size();
+    for (qsizetype i = 0; i < size; ++i)
+    {
+        char32_t code = units[i];
+        if (code < 0x80)
+        {
+            if (code == u'"')
+                *p++ = '"';
+            *p++ = static_cast<char>(code);
+            continue;
+        }
+        if (QChar::isHighSurrogate(code) && i + 1 < size && QChar::isLowSurrogate(units[i + 1]))
+            code = QChar::surrogateToUcs4(static_cast<char16_t>(code), units[++i]);
+        else if (QChar::isSurrogate(code))
+            code = QChar::ReplacementCharacter;
+
+        if (code < 0x800)
+        {
+            *p++ = static_cast<char>(0xC0 | (code >> 6));
+        }
+        else if (code < 0x10000)
+        {
+            *p++ = static_cast<char>(0xE0 | (code >> 12));
+            *p++ = static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        }
+        else
+        {
+            *p++ = static_cast<char>(0xF0 | (code >> 18));
+            *p++ = static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+            *p++ = static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        }
+        *p++ = static_cast<char>(0x80 | (code & 0x3F));
+    }
+    if (needsQuotes)
+        *p++ = '"';
+    m_used += p - out;
+    return *this;
+}
+
+Writer &Writer::field(qint64 value)
+{
+    return fixed(value, 0);
+}
+
+Writer &Writer::fixed(qint64 scaled, int decimals)
+{
+    separator();
+    const quint64 magnitude = scaled < 0 ? 0ULL - static_cast<quint64>(scaled) : static_cast<quint64>(scaled);
+    char digits[24];
+    char *end = digits + sizeof(digits);
+    char *p = end;
+    quint64 rest = magnitude;
+    int written = 0;
+    do
+    {
+        *--p = static_cast<char>('0' + rest % 10);
+        rest /= 10;
+        if (++written == decimals)
+            *--p = '.';
+    } while (rest != 0 || written <= decimals);
+    if (scaled < 0)
+        *--p = '-';
+
+    char *out = reserve(end - p);
+    std::memcpy(out, p, static_cast<std::size_t>(end - p));
+    m_used += end - p;
+    return *this;
+}
+
+Writer &Writer::compactTime(const QDateTime &dateTime)
+{
+    const Timestamp::Civil civil = dateTime.isValid() ? Timestamp::fromDateTime(dateTime) : Timestamp::Civil{};
+    if (!Timestamp::isValid(civil))
+        return field(Timestamp::toCompact(dateTime));
+    separator();
+    Timestamp::writeCompact(civil, reserve(14));
+    m_used += 14;
+    return *this;
+}
+
+Writer &Writer::isoTime(const QDateTime &dateTime)
+{
+    const Timestamp::Civil civil = dateTime.isValid() && dateTime.timeSpec() == Qt::LocalTime ? Timestamp::fromDateTime(dateTime) : Timestamp::Civil{};
+    if (!Timestamp::isValid(civil))
+        return field(Timestamp::toIso(dateTime));
+    separator();
+    Timestamp::writeIso(civil, reserve(19));
+    m_used += 19;
+    return *this;
+}
+
+void Writer::endRow()
+{
+    *reserve(1) = '\n';
+    ++m_used;
+    m_rowStart = true;
+}
+
+void Writer::rawLine(QByteArrayView line)
+{
+    char *out = reserve(line.size() + 1);
+    std::memcpy(out, line.data(), static_cast<std::size_t>(line.size()));
+    out[line.size()] = '\n';
+    m_used += line.size() + 1;
+    m_rowStart = true;
+}
+
+bool Writer::finish()
+{
+    return flushBuffer() && m_ok;
+}
+
+char *Writer::reserve(qsizetype bytes)
+{
+    if (m_used + bytes > m_buffer.size())
+    {
+        flushBuffer();
+        if (bytes > m_buffer.size())
+            m_buffer.resize(bytes);
+    }
+    return m_buffer.data() + m_used;
+}
+
+bool Writer::flushBuffer()
+{
+    if (m_used > 0 && m_ok)
+        m_ok = m_device->write(m_buffer.constData(), m_used) == m_used;
+    m_used = 0;
+    return m_ok;
+}
+
+void Writer::separator()
+{
+    if (!m_rowStart)
+    {
+        *reserve(1) = ',';
+        ++m_used;
+    }
+    m_rowStart = false;
+}
+
+MappedFile::MappedFile(const QString &path)
+    : m_file(path)
+{
+    if (!m_file.open(QIODevice::ReadOnly))
+        return;
+    m_open = true;
+    const qint64 size = m_file.size();
+    if (size <= 0)
+        return;
+    if (uchar *mapped = m_file.map(0, size))
+    {
+        m_data = QByteArrayView(reinterpret_cast<const char *>(mapped), static_cast<qsizetype>(size));
+        return;
+    }
+    m_buffer = m_file.readAll();
+    m_data = m_buffer;
+}
+
+MappedFile::~MappedFile() = default;
+
+qsizetype recordLength(QByteArrayView data, bool final)
+{
+    qsizetype firstLine = 0;
+    qsizetype pos = 0;
+    bool inQuotes = false;
+    for (int lines = 1;; ++lines)
+    {
+        const auto *newline = static_cast<const char *>(std::memchr(data.data() + pos, '\n', static_cast<std::size_t>(data.size() - pos)));
+        if (!newline && !final)
+            return -1;
+        const qsizetype end = newline ? newline - data.data() : data.size();
+        const QByteArrayView line = data.sliced(pos, end - pos);
+        if (lines == 1)
+        {
+            firstLine = newline ? end + 1 : end;
+            const QByteArrayView head = trimmedAscii(line);
+            if (!head.isEmpty() && head.front() == '#')
+                return firstLine;
+        }
+        if (hasOddQuotes(line))
+            inQuotes = !inQuotes;
+        if (!newline)
+            return inQuotes ? firstLine : end;
+        pos = end + 1;
+        if (!inQuotes)
+            return pos;
+        if (lines >= kMaxRecordLines)
+            return firstLine;
+        if (pos >= data.size())
+            return final ? firstLine : -1;
+    }
+}
+
+qsizetype completeRecordsLength(QByteArrayView data)
+{
+    qsizetype pos = 0;
+    while (pos < data.size())
+    {
+        const qsizetype length = recordLength(data.sliced(pos), false);
+        if (length < 0)
+            break;
+        pos += length;
+    }
+    return pos;
+}
+
+std::vector<QByteArrayView> splitRecordChunks(QByteArrayView data, int chunkCount)
+{
+    data = skipBom(data);
+    chunkCount = std::max(1, chunkCount);
+    if (chunkCount == 1 || data.size() < chunkCount)
+        return {data};
+
+    // 记录边界取决于之前的引号，须从头顺序确定；不含引号的行各自是一条记录，
+    // 因此每次直接跳到下一个引号所在行，只对含引号的行调用 recordLength
+    const auto lineStart = [&](qsizetype from, qsizetype at)
+    {
+        while (at > from && data[at - 1] != '\n')
+            --at;
+        return at;
+    };
+    std::vector<QByteArrayView> chunks;
+    qsizetype start = 0;
+    qsizetype pos = 0;
+    for (int i = 1; i < chunkCount && pos < data.size(); ++i)
+    {
+        const qsizetype target = data.size() * i / chunkCount;
+        while (pos < target)
+        {
+            const auto *quote = static_cast<const char *>(std::memchr(data.data() + pos, '"', static_cast<std::size_t>(data.size() - pos)));
+            const qsizetype quotePos = quote ? quote - data.data() : data.size();
+            pos = lineStart(pos, std::min(quotePos, target));
+            pos += recordLength(data.sliced(pos), true);
+        }
+        if (pos >= data.size())
+            break;
+        if (pos > start)
+        {
+            chunks.push_back(data.sliced(start, pos - start));
+            start = pos;
+        }
+    }
+    if (start < data.size())
+        chunks.push_back(data.sliced(start));
+    return chunks;
+}
+
+int splitUnquoted(QByteArrayView line, QByteArrayView *fields, int maxFields)
+{
+    if (std::memchr(line.data(), '"', static_cast<std::size_t>(line.size())))
+        return -1;
+    int count = 0;
+    while (true)
+    {
+        const auto *comma = static_cast<const char *>(std::memchr(line.data(), ',', static_cast<std::size_t>(line.size())));
+        const qsizetype length = comma ? comma - line.data() : line.size();
+        if (count < maxFields)
+            fields[count] = line.first(length);
+        ++count;
+        if (!comma)
+            return count;
+        line = line.sliced(length + 1);
+    }
+}
+
+QString fieldToString(QByteArrayView field)
+{
+    field = trimmedAscii(field);
+    if (isAscii(field))
+        return QString::fromLatin1(field.data(), field.size());
+    // 非 ASCII 字段可能带有全角空格等 Unicode 空白
+    return QString::fromUtf8(field.data(), field.size()).trimmed();
+}
+
+int fieldToInt(QByteArrayView field, bool *ok)
+{
+    field = trimmedAscii(field);
+    qsizetype i = 0;
+    bool negative = false;
+    if (i < field.size() && (field[i] == '+' || field[i] == '-'))
+    {
+        negative = field[i] == '-';
+        ++i;
+    }
+    qint64 value = 0;
+    bool valid = i < field.size();
+    for (; valid && i < field.size(); ++i)
+    {
+        const char ch = field[i];
+        if (ch < '0' || ch > '9')
+            valid = false;
+        else
+            value = value * 10 + (ch - '0');
+        if (value > static_cast<qint64>(std::numeric_limits<int>::max()) + 1)
+            valid = false;
+    }
+    if (valid)
+        value = negative ? -value : value;
+    if (valid && (value < std::numeric_limits<int>::min() || value > std::numeric_limits<int>::max()))
+        valid = false;
+    if (ok)
+        *ok = valid;
+    return valid ? static_cast<int>(value) : 0;
+}
+}
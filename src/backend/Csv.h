@@ -0,0 +1,250 @@
+#pragma once
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QFile>
+#include <QString>
+#include <QStringList>
+#include <QStringView>
+#include <QThread>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <vector>
+
+class QDateTime;
+class QIODevice;
+class QTextStream;
+
+// 数据文件共用的 CSV 读写：字段含逗号、换行或引号时加引号，引号写作两个引号
+namespace Csv
+{
+QStringList parseLine(const QString &line);
+QString encodeField(const QString &field);
+void writeRow(QTextStream &out, const QStringList &fields);
+
+// 大批量写出用的 CSV 写入器：字段直接编码为 UTF-8 写入缓冲区，需要时原地加引号，
+// 整数、定点小数与时间戳按位写出，不构造临时 QString；缓冲区满 blockBytes 后整块写入设备。
+// 输出与逐行调用 writeRow 相同。写入失败后忽略后续内容，由 finish() 返回结果
+class Writer
+{
+public:
+    explicit Writer(QIODevice *device, qsizetype blockBytes = 1024 * 1024);
+    Writer(const Writer &) = delete;
+    Writer &operator=(const Writer &) = delete;
+
+    Writer &field(QStringView text);
+    Writer &field(qint64 value);
+    // scaled 除以 10^decimals 后的定点小数，如 fixed(-1230, 2) 写出 "-12.30"，与 Money::toString 一致
+    Writer &fixed(qint64 scaled, int decimals);
+    // 与 Timestamp::toCompact / toIso 的结果相同
+    Writer &compactTime(const QDateTime &dateTime);
+    Writer &isoTime(const QDateTime &dateTime);
+    void endRow();
+    // 原样写出一行，不做 CSV 编码，用于 "# journal-seq N" 这类首行
+    void rawLine(QByteArrayView line);
+
+    // 写出缓冲区剩余内容，返回此前全部写入是否成功
+    bool finish();
+
+private:
+    char *reserve(qsizetype bytes);
+    bool flushBuffer();
+    void separator();
+
+    QIODevice *m_device;
+    QByteArray m_buffer;
+    qsizetype m_used{0};
+    bool m_rowStart{true};
+    bool m_ok{true};
+};
+
+// 只读映射整个文件，映射失败时退回一次性读入内存；data() 在对象存活期间有效
+class MappedFile
+{
+public:
+    explicit MappedFile(const QString &path);
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool isOpen() const { return m_open; }
+    QByteArrayView data() const { return m_data; }
+
+private:
+    QFile m_file;
+    QByteArray m_buffer;
+    QByteArrayView m_data;
+    bool m_open{false};
+};
+
+inline bool isAsciiSpace(char ch)
+{
+    return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r' || ch == '\v' || ch == '\f';
+}
+
+inline QByteArrayView trimmedAscii(QByteArrayView text)
+{
+    qsizetype begin = 0;
+    qsizetype end = text.size();
+    while (begin < end && isAsciiSpace(text[begin]))
+        ++begin;
+    while (end > begin && isAsciiSpace(text[end - 1]))
+        --end;
+    return text.sliced(begin, end - begin);
+}
+
+inline bool isAscii(QByteArrayView text)
+{
+    for (const char ch : text)
+    {
+        if (static_cast<unsigned char>(ch) >= 0x80)
+            return false;
+    }
+    return true;
+}
+
+inline QByteArrayView skipBom(QByteArrayView data)
+{
+    return data.startsWith(QByteArrayView("\xEF\xBB\xBF", 3)) ? data.sliced(3) : data;
+}
+
+// 引号个数为奇数时跨过该段后引号状态翻转；"" 转义成对出现，不影响结果
+inline bool hasOddQuotes(QByteArrayView text)
+{
+    bool odd = false;
+    const char *p = text.data();
+    const char *end = p + text.size();
+    while (const auto *quote = static_cast<const char *>(std::memchr(p, '"', static_cast<std::size_t>(end - p))))
+    {
+        odd = !odd;
+        p = quote + 1;
+    }
+    return odd;
+}
+
+// 按行遍历映射内容，回调参数为去除首尾 ASCII 空白后的非空行，不含换行符；
+// 跳过 UTF-8 BOM 与以 # 开头的注释行
+template <typename Visit>
+void forEachLine(QByteArrayView data, Visit &&visit)
+{
+    data = skipBom(data);
+    while (!data.isEmpty())
+    {
+        const auto *newline = static_cast<const char *>(std::memchr(data.data(), '\n', static_cast<std::size_t>(data.size())));
+        const qsizetype length = newline ? newline - data.data() : data.size();
+        const QByteArrayView line = trimmedAscii(data.first(length));
+        data = newline ? data.sliced(length + 1) : QByteArrayView();
+        if (line.isEmpty() || line.front() == '#')
+            continue;
+        visit(line);
+    }
+}
+
+// 引号内的换行属于字段内容（encodeField 会这样写出），一条记录可以跨多行；
+// 引号在这么多行内仍未闭合时视为该行残缺，只把这一行当作记录，从下一行重新开始
+inline constexpr int kMaxRecordLines = 64;
+
+// data 开头第一条记录的长度（含结尾换行）。引号外以 # 开头的行是单独一条注释记录；
+// final 为 false 表示 data 之后还有内容，记录在 data 内无法确定时返回 -1
+qsizetype recordLength(QByteArrayView data, bool final);
+
+// 与 forEachLine 相同，但按 CSV 记录遍历，回调得到的记录可能跨多行；
+// 一个多余的引号至多使所在的一行失效，不会吞掉之后的记录
+template <typename Visit>
+void forEachRecord(QByteArrayView data, Visit &&visit)
+{
+    data = skipBom(data);
+    while (!data.isEmpty())
+    {
+        const qsizetype length = recordLength(data, true);
+        const QByteArrayView record = trimmedAscii(data.first(length));
+        data = data.sliced(length);
+        if (record.isEmpty() || record.front() == '#')
+            continue;
+        visit(record);
+    }
+}
+
+// data 中完整记录部分的长度，即按 recordLength 能确定的最后一条记录之后的位置；没有完整记录时为 0
+qsizetype completeRecordsLength(QByteArrayView data);
+
+// 按块顺序读取文件并逐条回调记录，回调参数与 forEachRecord 相同；内存占用只与
+// blockBytes 和最长记录有关，不随文件大小增长。文件无法打开或读取出错时返回 false
+template <typename Visit>
+bool forEachRecordStreamed(const QString &path, qint64 blockBytes, Visit &&visit)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QByteArray buffer;
+    while (true)
+    {
+        const QByteArray block = file.read(blockBytes);
+        const bool atEnd = block.isEmpty();
+        buffer += block;
+        // 块尾未结束的记录留到下一块拼接
+        const qsizetype length = atEnd ? buffer.size() : completeRecordsLength(buffer);
+        forEachRecord(QByteArrayView(buffer).first(length), visit);
+        buffer.remove(0, length);
+        if (atEnd)
+            return file.error() == QFileDevice::NoError;
+    }
+}
+
+// 在记录边界处把 data 切成至多 chunkCount 段，每段都由完整记录组成，
+// 依次拼接后等于去掉 BOM 的 data；不含引号的区间直接跳过，只有含引号的行才逐条确定记录边界
+std::vector<QByteArrayView> splitRecordChunks(QByteArrayView data, int chunkCount);
+
+// 小于该大小的文件直接单线程解析，线程调度开销不值得
+inline constexpr qsizetype kParallelParseThreshold = 8 * 1024 * 1024;
+
+// 分段并行解析：parseChunk(QByteArrayView chunk, std::vector<T> &out) 解析一段完整记录，
+// 各段结果按文件顺序拼接，与对整个文件调用一次 parseChunk 的结果相同。
+// threadCount 为 0 时取 QThread::idealThreadCount()
+template <typename T, typename ParseChunk>
+std::vector<T> parseChunked(QByteArrayView data, ParseChunk &&parseChunk, int threadCount = 0)
+{
+    std::vector<T> out;
+    data = skipBom(data);
+    if (threadCount <= 0)
+        threadCount = QThread::idealThreadCount();
+    if (threadCount <= 1 || data.size() < kParallelParseThreshold)
+    {
+        parseChunk(data, out);
+        return out;
+    }
+
+    const std::vector<QByteArrayView> chunks = splitRecordChunks(data, threadCount);
+    std::vector<std::vector<T>> parts(chunks.size());
+    QThreadPool pool;
+    pool.setMaxThreadCount(threadCount);
+    for (std::size_t i = 0; i < chunks.size(); ++i)
+    {
+        pool.start([&, i]()
+                   { parseChunk(chunks[i], parts[i]); });
+    }
+    pool.waitForDone();
+
+    std::size_t total = 0;
+    for (const auto &part : parts)
+        total += part.size();
+    out.reserve(total);
+    for (auto &part : parts)
+        out.insert(out.end(), std::make_move_iterator(part.begin()), std::make_move_iterator(part.end()));
+    return out;
+}
+
+// 不含引号的行直接在字节上按逗号切分，写入前 maxFields 个字段并返回总字段数；
+// 含引号的行返回 -1，由调用方改用 parseLine
+int splitUnquoted(QByteArrayView line, QByteArrayView *fields, int maxFields);
+
+// 字段转为去除首尾空白的 QString：纯 ASCII 按 Latin-1 直接拷贝，否则按 UTF-8 解码
+QString fieldToString(QByteArrayView field);
+
+// 与 QString::toInt 相同，允许首尾空白和正负号，失败时返回 0
+int fieldToInt(QByteArrayView field, bool *ok = nullptr);
+}
@@ -0,0 +1,160 @@
+#include "backend/FeeKernel.h"
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || ((defined(__i386__) || defined(_M_IX86)) && defined(__SSE2__))
+#define NETBILLING_FEE_KERNEL_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define NETBILLING_TARGET_AVX2
+#else
+#define NETBILLING_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace
+{
+    // 与 TariffCatalog::fee 相同：未登记编号按 0 号套餐，超出分钟数下限为 0
+    void computeScalar(const TariffTable &table, const qint32 *plans, const qint32 *minutes,
+                       qint64 *amountCents, std::size_t begin, std::size_t count)
+    {
+        for (std::size_t i = begin; i < count; ++i)
+        {
+            const qint32 plan = (plans[i] >= 0 && plans[i] < table.size) ? plans[i] : 0;
+            const qint64 overage = std::max<qint64>(0, static_cast<qint64>(minutes[i]) - table.includedMinutes[plan]);
+            amountCents[i] = table.baseFeeCents[plan] + table.pricePerMinuteCents[plan] * overage;
+        }
+    }
+
+#ifdef NETBILLING_FEE_KERNEL_X86
+    // 没有收集指令，逐项取表后用 32×32→64 位乘法两路并行
+    void computeSse2(const TariffTable &table, const qint32 *plans, const qint32 *minutes,
+                     qint64 *amountCents, std::size_t count)
+    {
+        std::size_t i = 0;
+        for (; i + 2 <= count; i += 2)
+        {
+            const qint32 p0 = (plans[i] >= 0 && plans[i] < table.size) ? plans[i] : 0;
+            const qint32 p1 = (plans[i + 1] >= 0 && plans[i + 1] < table.size) ? plans[i + 1] : 0;
+            const qint32 over0 = std::max(0, minutes[i] - table.includedMinutes[p0]);
+            const qint32 over1 = std::max(0, minutes[i + 1] - table.includedMinutes[p1]);
+            const __m128i base = _mm_set_epi64x(table.baseFeeCents[p1], table.baseFeeCents[p0]);
+            const __m128i price = _mm_set_epi64x(table.pricePerMinuteCents[p1], table.pricePerMinuteCents[p0]);
+            const __m128i over = _mm_set_epi64x(over1, over0);
+            const __m128i fee = _mm_add_epi64(base, _mm_mul_epu32(price, over));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(amountCents + i), fee);
+        }
+        computeScalar(table, plans, minutes, amountCents, i, count);
+    }
+
+    // 每次处理 4 项：收集费率、钳位超出分钟数、乘加得到费用
+    NETBILLING_TARGET_AVX2 void computeAvx2(const TariffTable &table, const qint32 *plans, const qint32 *minutes,
+                                            qint64 *amountCents, std::size_t count)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i size = _mm_set1_epi32(table.size);
+        const auto *baseFees = reinterpret_cast<const long long *>(table.baseFeeCents);
+        const auto *prices = reinterpret_cast<const long long *>(table.pricePerMinuteCents);
+        const auto *included = reinterpret_cast<const int *>(table.includedMinutes);
+
+        std::size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128i plan = _mm_loadu_si128(reinterpret_cast<const __m128i *>(plans + i));
+            const __m128i valid = _mm_andnot_si128(_mm_cmpgt_epi32(zero, plan), _mm_cmpgt_epi32(size, plan));
+            plan = _mm_and_si128(plan, valid);
+
+            const __m128i mins = _mm_loadu_si128(reinterpret_cast<const __m128i *>(minutes + i));
+            const __m128i inc = _mm_i32gather_epi32(included, plan, 4);
+            const __m128i over = _mm_max_epi32(_mm_sub_epi32(mins, inc), zero);
+
+            const __m256i base = _mm256_i32gather_epi64(baseFees, plan, 8);
+            const __m256i price = _mm256_i32gather_epi64(prices, plan, 8);
+            const __m256i fee = _mm256_add_epi64(base, _mm256_mul_epu32(price, _mm256_cvtepu32_epi64(over)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(amountCents + i), fee);
+        }
+        computeScalar(table, plans, minutes, amountCents, i, count);
+    }
+
+    bool cpuHasAvx2()
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        int regs[4] = {};
+        __cpuid(regs, 0);
+        if (regs[0] < 7)
+            return false;
+        __cpuid(regs, 1);
+        const bool osxsave = (regs[2] & (1 << 27)) != 0;
+        const bool avx = (regs[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+            return false;
+        __cpuidex(regs, 7, 0);
+        return (regs[1] & (1 << 5)) != 0;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+#endif
+
+    FeeKernel::Isa detectIsa()
+    {
+#ifdef NETBILLING_FEE_KERNEL_X86
+        return cpuHasAvx2() ? FeeKernel::Isa::Avx2 : FeeKernel::Isa::Sse2;
+#else
+        return FeeKernel::Isa::Scalar;
+#endif
+    }
+} // namespace
+
+namespace FeeKernel
+{
+Isa bestIsa()
+{
+    static const Isa isa = detectIsa();
+    return isa;
+}
+
+const char *isaName(Isa isa)
+{
+    switch (isa)
+    {
+    case Isa::Scalar:
+        return "scalar";
+    case Isa::Sse2:
+        return "sse2";
+    case Isa::Avx2:
+        return "avx2";
+    }
+    return "unknown";
+}
+
+void compute(const TariffTable &table, const qint32 *plans, const qint32 *minutes,
+             qint64 *amountCents, std::size_t count)
+{
+    compute(bestIsa(), table, plans, minutes, amountCents, count);
+}
+
+void compute(Isa isa, const TariffTable &table, const qint32 *plans, const qint32 *minutes,
+             qint64 *amountCents, std::size_t count)
+{
+    if (static_cast<int>(isa) > static_cast<int>(bestIsa()))
+        isa = bestIsa();
+
+    switch (isa)
+    {
+#ifdef NETBILLING_FEE_KERNEL_X86
+    case Isa::Avx2:
+        computeAvx2(table, plans, minutes, amountCents, count);
+        return;
+    case Isa::Sse2:
+        computeSse2(table, plans, minutes, amountCents, count);
+        return;
+#endif
+    default:
+        computeScalar(table, plans, minutes, amountCents, 0, count);
+        return;
+    }
+}
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "backend/TariffCatalog.h"
+
+#include <cstddef>
+
+// 批量计费内核：按列输入套餐编号与分钟数，输出以分为单位的费用列，
+// 结果与 TariffCatalog::fee 逐项一致
+namespace FeeKernel
+{
+enum class Isa
+{
+    Scalar,
+    Sse2,
+    Avx2
+};
+
+// 运行时检测 CPU 支持的最佳指令集，结果在首次调用后缓存
+Isa bestIsa();
+const char *isaName(Isa isa);
+
+void compute(const TariffTable &table,
+             const qint32 *plans,
+             const qint32 *minutes,
+             qint64 *amountCents,
+             std::size_t count);
+
+// 指定指令集计算；不受当前 CPU 支持的指令集会退回 bestIsa()
+void compute(Isa isa,
+             const TariffTable &table,
+             const qint32 *plans,
+             const qint32 *minutes,
+             qint64 *amountCents,
+             std::size_t count);
+}
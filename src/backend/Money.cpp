@@ -0,0 +1,89 @@
+#include "backend/Money.h"
+
+#include <cmath>
+
+Money Money::fromYuan(double yuan)
+{
+    return fromCents(static_cast<qint64>(std::llround(yuan * 100.0)));
+}
+
+Money Money::parse(QStringView text, bool *ok)
+{
+    const QStringView trimmed = text.trimmed();
+    qsizetype i = 0;
+    bool negative = false;
+    if (i < trimmed.size() && (trimmed[i] == QLatin1Char('-') || trimmed[i] == QLatin1Char('+')))
+    {
+        negative = trimmed[i] == QLatin1Char('-');
+        ++i;
+    }
+
+    qint64 whole = 0;
+    qint64 fraction = 0;
+    int fractionDigits = 0;
+    bool roundUp = false;
+    bool anyDigit = false;
+    bool valid = i < trimmed.size();
+    bool inFraction = false;
+    for (; valid && i < trimmed.size(); ++i)
+    {
+        const QChar ch = trimmed[i];
+        if (ch == QLatin1Char('.') && !inFraction)
+        {
+            inFraction = true;
+            continue;
+        }
+        if (ch < QLatin1Char('0') || ch > QLatin1Char('9'))
+        {
+            valid = false;
+            break;
+        }
+        const int digit = ch.unicode() - '0';
+        anyDigit = true;
+        if (!inFraction)
+        {
+            whole = whole * 10 + digit;
+        }
+        else if (fractionDigits < 2)
+        {
+            fraction = fraction * 10 + digit;
+            ++fractionDigits;
+        }
+        else if (fractionDigits == 2)
+        {
+            roundUp = digit >= 5;
+            ++fractionDigits;
+        }
+    }
+
+    if (!valid || !anyDigit)
+    {
+        // 兼容科学计数法等非常规写法
+        bool doubleOk = false;
+        const double value = trimmed.toString().toDouble(&doubleOk);
+        if (ok)
+            *ok = doubleOk;
+        return doubleOk ? fromYuan(value) : Money();
+    }
+
+    for (; fractionDigits < 2; ++fractionDigits)
+        fraction *= 10;
+    qint64 cents = whole * 100 + fraction + (roundUp ? 1 : 0);
+    if (ok)
+        *ok = true;
+    return fromCents(negative ? -cents : cents);
+}
+
+QString Money::toString() const
+{
+    const quint64 magnitude = m_cents < 0 ? 0ULL - static_cast<quint64>(m_cents) : static_cast<quint64>(m_cents);
+    QString text;
+    if (m_cents < 0)
+        text.append(QLatin1Char('-'));
+    text.append(QString::number(magnitude / 100));
+    text.append(QLatin1Char('.'));
+    const auto rest = static_cast<int>(magnitude % 100);
+    text.append(QLatin1Char(static_cast<char>('0' + rest / 10)));
+    text.append(QLatin1Char(static_cast<char>('0' + rest % 10)));
+    return text;
+}
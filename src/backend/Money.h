@@ -0,0 +1,55 @@
+#pragma once
+
+#include <QMetaType>
+#include <QString>
+#include <QStringView>
+#include <QtGlobal>
+
+// 以“分”为单位的定点金额，余额、账单与充值流水统一使用，避免浮点累计误差
+class Money
+{
+public:
+    constexpr Money() = default;
+
+    static constexpr Money fromCents(qint64 cents)
+    {
+        Money m;
+        m.m_cents = cents;
+        return m;
+    }
+    static Money fromYuan(double yuan);
+    // 解析形如 "-12.5"、"300"、"0.03" 的十进制文本；超过两位小数时四舍五入
+    static Money parse(QStringView text, bool *ok = nullptr);
+
+    constexpr qint64 cents() const { return m_cents; }
+    constexpr double toYuan() const { return static_cast<double>(m_cents) / 100.0; }
+    // 固定两位小数，例如 "-12.30"，不经过浮点格式化
+    QString toString() const;
+
+    constexpr Money operator-() const { return fromCents(-m_cents); }
+    constexpr Money operator+(Money other) const { return fromCents(m_cents + other.m_cents); }
+    constexpr Money operator-(Money other) const { return fromCents(m_cents - other.m_cents); }
+    constexpr Money operator*(qint64 factor) const { return fromCents(m_cents * factor); }
+    Money &operator+=(Money other)
+    {
+        m_cents += other.m_cents;
+        return *this;
+    }
+    Money &operator-=(Money other)
+    {
+        m_cents -= other.m_cents;
+        return *this;
+    }
+
+    constexpr bool operator==(Money other) const { return m_cents == other.m_cents; }
+    constexpr bool operator!=(Money other) const { return m_cents != other.m_cents; }
+    constexpr bool operator<(Money other) const { return m_cents < other.m_cents; }
+    constexpr bool operator<=(Money other) const { return m_cents <= other.m_cents; }
+    constexpr bool operator>(Money other) const { return m_cents > other.m_cents; }
+    constexpr bool operator>=(Money other) const { return m_cents >= other.m_cents; }
+
+private:
+    qint64 m_cents{0};
+};
+
+Q_DECLARE_METATYPE(Money)
@@ -0,0 +1,281 @@
+#include "backend/SessionFile.h"
+
+#include <QSaveFile>
+#include <QSysInfo>
+
+#include <cstring>
+#include <unordered_map>
+
+namespace
+{
+    constexpr char kMagic[4] = {'N', 'B', 'S', 'F'};
+
+    struct Header
+    {
+        char magic[4];
+        quint32 version;
+        quint64 rowCount;
+        quint32 accountCount;
+        quint32 blockRows;
+        qint64 sourceSize;
+        qint64 sourceModified; // 毫秒
+        quint64 stringsSize;
+        quint64 stringsChecksum;
+        quint64 reserved;
+    };
+    static_assert(sizeof(Header) == 64, "SessionFile header must stay 64 bytes");
+
+    constexpr quint64 align8(quint64 value)
+    {
+        return (value + 7) & ~quint64(7);
+    }
+
+    // 两路累加的 Fletcher 式校验和，按 8 字节字处理，用于发现截断与位翻转
+    quint64 checksum(const uchar *data, std::size_t size, quint64 seed = 0)
+    {
+        quint64 a = seed ^ 0x9E3779B97F4A7C15ULL;
+        quint64 b = 0;
+        std::size_t i = 0;
+        for (; i + 8 <= size; i += 8)
+        {
+            quint64 word;
+            std::memcpy(&word, data + i, 8);
+            a += word;
+            b += a;
+        }
+        quint64 tail = 0;
+        std::memcpy(&tail, data + i, size - i);
+        a += tail + size;
+        b += a;
+        return a ^ (b * 0xBF58476D1CE4E5B9ULL);
+    }
+
+    struct Layout
+    {
+        quint64 checksumsOffset;
+        quint64 blockCount;
+        quint64 idsOffset;
+        quint64 beginOffset;
+        quint64 endOffset;
+        quint64 totalSize;
+    };
+
+    Layout layoutFor(quint64 rowCount, quint64 stringsSize)
+    {
+        Layout layout;
+        layout.checksumsOffset = align8(sizeof(Header) + stringsSize);
+        layout.blockCount = (rowCount + SessionFile::kBlockRows - 1) / SessionFile::kBlockRows;
+        layout.idsOffset = layout.checksumsOffset + layout.blockCount * 8;
+        layout.beginOffset = align8(layout.idsOffset + rowCount * 4);
+        layout.endOffset = layout.beginOffset + rowCount * 8;
+        layout.totalSize = layout.endOffset + rowCount * 8;
+        return layout;
+    }
+
+    quint64 blockChecksum(const uchar *base, const Layout &layout, quint64 rowCount, quint64 block)
+    {
+        const quint64 first = block * SessionFile::kBlockRows;
+        const quint64 rows = std::min<quint64>(SessionFile::kBlockRows, rowCount - first);
+        quint64 sum = checksum(base + layout.idsOffset + first * 4, rows * 4, block);
+        sum = checksum(base + layout.beginOffset + first * 8, rows * 8, sum);
+        return checksum(base + layout.endOffset + first * 8, rows * 8, sum);
+    }
+
+    QDateTime fromSecs(qint64 value, qint64 invalid)
+    {
+        return value == invalid ? QDateTime() : QDateTime::fromSecsSinceEpoch(value);
+    }
+} // namespace
+
+SessionFile::~SessionFile()
+{
+    close();
+}
+
+bool SessionFile::write(const QString &path, const std::vector<Session> &sessions, const QFileInfo &source, QString *error)
+{
+    const auto setError = [&](const QString &msg)
+    {
+        if (error)
+            *error = msg;
+        return false;
+    };
+    if (QSysInfo::ByteOrder != QSysInfo::LittleEndian)
+        return setError(QStringLiteral(u"当前平台不支持二进制会话文件。"));
+
+    // 账号字符串表：按首次出现顺序编号，每项为 u32 长度 + UTF-8 字节
+    std::unordered_map<QString, quint32> idOf;
+    QByteArray strings;
+    std::vector<quint32> ids;
+    ids.reserve(sessions.size());
+    for (const auto &session : sessions)
+    {
+        auto [it, inserted] = idOf.try_emplace(session.account, static_cast<quint32>(idOf.size()));
+        if (inserted)
+        {
+            const QByteArray utf8 = session.account.toUtf8();
+            const quint32 length = static_cast<quint32>(utf8.size());
+            strings.append(reinterpret_cast<const char *>(&length), 4);
+            strings.append(utf8);
+        }
+        ids.push_back(it->second);
+    }
+
+    const quint64 rowCount = sessions.size();
+    const Layout layout = layoutFor(rowCount, static_cast<quint64>(strings.size()));
+    QByteArray buffer(static_cast<qsizetype>(layout.totalSize), '\0');
+    auto *base = reinterpret_cast<uchar *>(buffer.data());
+
+    std::memcpy(base + sizeof(Header), strings.constData(), static_cast<std::size_t>(strings.size()));
+    std::memcpy(base + layout.idsOffset, ids.data(), ids.size() * 4);
+    auto *begin = reinterpret_cast<qint64 *>(base + layout.beginOffset);
+    auto *end = reinterpret_cast<qint64 *>(base + layout.endOffset);
+    for (std::size_t i = 0; i < sessions.size(); ++i)
+    {
+        begin[i] = beginSecsOf(sessions[i].begin);
+        end[i] = endSecsOf(sessions[i].end);
+    }
+    auto *checksums = reinterpret_cast<quint64 *>(base + layout.checksumsOffset);
+    for (quint64 block = 0; block < layout.blockCount; ++block)
+        checksums[block] = blockChecksum(base, layout, rowCount, block);
+
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.rowCount = rowCount;
+    header.accountCount = static_cast<quint32>(idOf.size());
+    header.blockRows = kBlockRows;
+    header.sourceSize = source.exists() ? source.size() : -1;
+    header.sourceModified = source.exists() ? source.lastModified().toMSecsSinceEpoch() : 0;
+    header.stringsSize = static_cast<quint64>(strings.size());
+    header.stringsChecksum = checksum(base + sizeof(Header), static_cast<std::size_t>(strings.size()));
+    std::memcpy(base, &header, sizeof(Header));
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return setError(QStringLiteral(u"无法写入会话快照：%1").arg(path));
+    if (file.write(buffer) != buffer.size() || !file.commit())
+        return setError(QStringLiteral(u"写入会话快照失败：%1").arg(path));
+    return true;
+}
+
+bool SessionFile::open(const QString &path, QString *error)
+{
+    close();
+    const auto fail = [&](const QString &msg)
+    {
+        close();
+        if (error)
+            *error = msg;
+        return false;
+    };
+    if (QSysInfo::ByteOrder != QSysInfo::LittleEndian)
+        return fail(QStringLiteral(u"当前平台不支持二进制会话文件。"));
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly))
+        return fail(QStringLiteral(u"无法打开会话快照：%1").arg(path));
+    const qint64 fileSize = m_file.size();
+    if (fileSize < static_cast<qint64>(sizeof(Header)))
+        return fail(QStringLiteral(u"会话快照已截断。"));
+    m_map = m_file.map(0, fileSize);
+    if (!m_map)
+        return fail(QStringLiteral(u"无法映射会话快照：%1").arg(path));
+
+    Header header;
+    std::memcpy(&header, m_map, sizeof(Header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0)
+        return fail(QStringLiteral(u"会话快照格式无效。"));
+    if (header.version != kVersion || header.blockRows != kBlockRows)
+        return fail(QStringLiteral(u"不支持的会话快照版本：%1").arg(header.version));
+    if (header.stringsSize > static_cast<quint64>(fileSize) || header.rowCount > static_cast<quint64>(fileSize))
+        return fail(QStringLiteral(u"会话快照已截断。"));
+    const Layout layout = layoutFor(header.rowCount, header.stringsSize);
+    if (layout.totalSize != static_cast<quint64>(fileSize))
+        return fail(QStringLiteral(u"会话快照已截断。"));
+
+    const uchar *strings = m_map + sizeof(Header);
+    if (checksum(strings, header.stringsSize) != header.stringsChecksum)
+        return fail(QStringLiteral(u"会话快照账号表校验失败。"));
+    const auto *checksums = reinterpret_cast<const quint64 *>(m_map + layout.checksumsOffset);
+    for (quint64 block = 0; block < layout.blockCount; ++block)
+    {
+        if (blockChecksum(m_map, layout, header.rowCount, block) != checksums[block])
+            return fail(QStringLiteral(u"会话快照第 %1 块校验失败。").arg(block));
+    }
+
+    m_accounts.reserve(header.accountCount);
+    quint64 offset = 0;
+    for (quint32 i = 0; i < header.accountCount; ++i)
+    {
+        quint32 length = 0;
+        if (offset + 4 > header.stringsSize)
+            return fail(QStringLiteral(u"会话快照账号表损坏。"));
+        std::memcpy(&length, strings + offset, 4);
+        offset += 4;
+        if (offset + length > header.stringsSize)
+            return fail(QStringLiteral(u"会话快照账号表损坏。"));
+        m_accounts.push_back(QString::fromUtf8(reinterpret_cast<const char *>(strings + offset), static_cast<qsizetype>(length)));
+        offset += length;
+    }
+
+    m_rows = reinterpret_cast<const quint32 *>(m_map + layout.idsOffset);
+    m_begin = reinterpret_cast<const qint64 *>(m_map + layout.beginOffset);
+    m_end = reinterpret_cast<const qint64 *>(m_map + layout.endOffset);
+    m_rowCount = static_cast<std::size_t>(header.rowCount);
+    for (std::size_t i = 0; i < m_rowCount; ++i)
+    {
+        if (m_rows[i] >= header.accountCount)
+            return fail(QStringLiteral(u"会话快照账号编号越界。"));
+    }
+    m_sourceSize = header.sourceSize;
+    m_sourceModified = header.sourceModified;
+    m_open = true;
+    return true;
+}
+
+void SessionFile::close()
+{
+    if (m_map)
+        m_file.unmap(m_map);
+    m_file.close();
+    m_map = nullptr;
+    m_open = false;
+    m_rowCount = 0;
+    m_accounts.clear();
+    m_rows = nullptr;
+    m_begin = nullptr;
+    m_end = nullptr;
+}
+
+bool SessionFile::matchesSource(const QFileInfo &source) const
+{
+    if (!m_open)
+        return false;
+    if (!source.exists())
+        return false;
+    return source.size() == m_sourceSize && source.lastModified().toMSecsSinceEpoch() == m_sourceModified;
+}
+
+SessionColumns SessionFile::toColumns() const
+{
+    SessionColumns columns;
+    columns.accounts = m_accounts;
+    columns.accountIndex.assign(m_rows, m_rows + m_rowCount);
+    columns.beginSecs.assign(m_begin, m_begin + m_rowCount);
+    columns.endSecs.assign(m_end, m_end + m_rowCount);
+    return columns;
+}
+
+std::vector<Session> SessionFile::toSessions() const
+{
+    std::vector<Session> sessions;
+    sessions.reserve(m_rowCount);
+    for (std::size_t i = 0; i < m_rowCount; ++i)
+    {
+        sessions.push_back(Session{m_accounts[m_rows[i]],
+                                   fromSecs(m_begin[i], kInvalidBeginSecs),
+                                   fromSecs(m_end[i], kInvalidEndSecs)});
+    }
+    return sessions;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "backend/Billing.h"
+#include "backend/Models.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QString>
+
+// 上网记录的二进制列式快照 sessions.nbs，与 sessions.csv 并存：
+// 头部 64 字节，其后依次为账号字符串表、每块校验和、账号编号列（u32）、
+// 开始时间列与结束时间列（i64，UTC 纪元秒），各段按 8 字节对齐。
+// 打开时整体映射并校验，列数据直接指向映射区，无需逐行解析。
+// 文件按小端序写入，大端主机上不可用（open 返回 false，调用方退回 CSV）。
+class SessionFile
+{
+public:
+    static constexpr quint32 kVersion = 1;
+    static constexpr quint32 kBlockRows = 64 * 1024;
+
+    SessionFile() = default;
+    ~SessionFile();
+    SessionFile(const SessionFile &) = delete;
+    SessionFile &operator=(const SessionFile &) = delete;
+
+    // source 为对应的 CSV 文件，其大小与修改时间写入头部，用于判断快照是否过期
+    static bool write(const QString &path, const std::vector<Session> &sessions, const QFileInfo &source, QString *error = nullptr);
+
+    bool open(const QString &path, QString *error = nullptr);
+    void close();
+    bool isOpen() const { return m_open; }
+    // CSV 的大小与修改时间都须与写入快照时一致；CSV 不存在时快照视为过期
+    bool matchesSource(const QFileInfo &source) const;
+
+    std::size_t size() const { return m_rowCount; }
+    const std::vector<QString> &accounts() const { return m_accounts; }
+    const quint32 *accountIds() const { return m_rows; }
+    const qint64 *beginSecs() const { return m_begin; }
+    const qint64 *endSecs() const { return m_end; }
+
+    SessionColumns toColumns() const;
+    std::vector<Session> toSessions() const;
+
+private:
+    QFile m_file;
+    uchar *m_map{nullptr};
+    bool m_open{false};
+    std::size_t m_rowCount{0};
+    qint64 m_sourceSize{-1};
+    qint64 m_sourceModified{0};
+    std::vector<QString> m_accounts;
+    const quint32 *m_rows{nullptr};
+    const qint64 *m_begin{nullptr};
+    const qint64 *m_end{nullptr};
+};
@@ -0,0 +1,255 @@
+#include "backend/SessionJournal.h"
+
+#include "backend/Csv.h"
+#include "backend/Timestamp.h"
+
+#include <QFile>
+#include <QHash>
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+namespace
+{
+    const QByteArray kBaseHeaderPrefix("# journal-seq ");
+
+    // 截到最后一个换行符，去掉中断写入留下的残行
+    QByteArrayView completeLines(QByteArrayView data)
+    {
+        const qsizetype lastNewline = data.lastIndexOf('\n');
+        return lastNewline < 0 ? QByteArrayView() : data.first(lastNewline + 1);
+    }
+
+    qint64 toSequence(QByteArrayView field, bool *ok)
+    {
+        field = Csv::trimmedAscii(field);
+        return QByteArray(field.data(), field.size()).toLongLong(ok);
+    }
+
+    struct SessionKey
+    {
+        QString account;
+        qint64 begin;
+        qint64 end;
+
+        bool operator==(const SessionKey &other) const
+        {
+            return begin == other.begin && end == other.end && account == other.account;
+        }
+    };
+
+    size_t qHash(const SessionKey &key, size_t seed = 0)
+    {
+        return qHashMulti(seed, key.account, key.begin, key.end);
+    }
+
+    qint64 keyTime(const QDateTime &dateTime)
+    {
+        return dateTime.isValid() ? dateTime.toMSecsSinceEpoch() : std::numeric_limits<qint64>::min();
+    }
+
+    SessionKey keyOf(const Session &session)
+    {
+        return SessionKey{session.account, keyTime(session.begin), keyTime(session.end)};
+    }
+
+    bool changeFromFields(const QStringList &fields, SessionChange *change)
+    {
+        const QString op = fields.value(1).trimmed();
+        if (op == QLatin1String("+"))
+            change->op = SessionChange::Op::Insert;
+        else if (op == QLatin1String("-"))
+            change->op = SessionChange::Op::Remove;
+        else
+            return false;
+        change->session = Session{fields.value(2).trimmed(),
+                                  Timestamp::fromCompact(QStringView(fields.value(3))),
+                                  Timestamp::fromCompact(QStringView(fields.value(4)))};
+        return !change->session.account.isEmpty();
+    }
+} // namespace
+
+namespace SessionJournal
+{
+qint64 baseSequence(const QString &basePath)
+{
+    QFile file(basePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return 0;
+
+    QByteArray line = file.readLine(256);
+    if (line.startsWith("\xEF\xBB\xBF"))
+        line.remove(0, 3);
+    if (!line.startsWith(kBaseHeaderPrefix))
+        return 0;
+    bool ok = false;
+    const qint64 sequence = toSequence(QByteArrayView(line).sliced(kBaseHeaderPrefix.size()), &ok);
+    return ok ? sequence : 0;
+}
+
+qint64 lastSequence(const QString &journalPath)
+{
+    Csv::MappedFile file(journalPath);
+    if (!file.isOpen())
+        return 0;
+
+    qint64 sequence = 0;
+    QByteArrayView data = completeLines(file.data());
+    while (!data.isEmpty() && sequence == 0)
+    {
+        data.chop(1);
+        const qsizetype lineStart = data.lastIndexOf('\n') + 1;
+        const QByteArrayView line = data.sliced(lineStart);
+        data.truncate(lineStart);
+
+        const qsizetype comma = line.indexOf(',');
+        bool ok = false;
+        const qint64 value = toSequence(comma < 0 ? line : line.first(comma), &ok);
+        if (ok)
+            sequence = value;
+    }
+    return sequence;
+}
+
+bool append(const QString &journalPath, const std::vector<SessionChange> &changes, qint64 firstSeq, QString *error)
+{
+    const auto setError = [&](const QString &msg) {
+        if (error)
+            *error = msg;
+    };
+
+    if (changes.empty())
+        return true;
+
+    QFile file(journalPath);
+    if (!file.open(QIODevice::ReadWrite))
+    {
+        setError(QStringLiteral(u"无法打开上网记录日志：%1").arg(journalPath));
+        return false;
+    }
+
+    const qint64 size = file.size();
+    if (size > 0 && file.seek(size - 1) && file.read(1) != QByteArray("\n"))
+    {
+        file.seek(0);
+        const QByteArray existing = file.readAll();
+        if (!file.resize(completeLines(existing).size()))
+        {
+            setError(QStringLiteral(u"无法修复上网记录日志：%1").arg(journalPath));
+            return false;
+        }
+    }
+
+    QByteArray buffer;
+    buffer.reserve(static_cast<qsizetype>(changes.size()) * 64);
+    qint64 sequence = firstSeq;
+    for (const auto &change : changes)
+    {
+        buffer += QByteArray::number(sequence++);
+        buffer += ',';
+        buffer += static_cast<char>(change.op);
+        buffer += ',';
+        buffer += Csv::encodeField(change.session.account).toUtf8();
+        buffer += ',';
+        buffer += Timestamp::toCompact(change.session.begin).toLatin1();
+        buffer += ',';
+        buffer += Timestamp::toCompact(change.session.end).toLatin1();
+        buffer += '\n';
+    }
+
+    // 整批一次写入并刷新，中途失败时残行会在下次追加或重放时被忽略
+    if (!file.seek(file.size()) || file.write(buffer) != buffer.size() || !file.flush())
+    {
+        setError(QStringLiteral(u"写入上网记录日志失败：%1").arg(journalPath));
+        return false;
+    }
+    return true;
+}
+
+void read(const QString &journalPath, qint64 afterSeq, std::vector<SessionChange> *changes)
+{
+    Csv::MappedFile file(journalPath);
+    if (!file.isOpen())
+        return;
+
+    Csv::forEachLine(completeLines(file.data()), [&](QByteArrayView line)
+                     {
+        QByteArrayView fields[5];
+        const int fieldCount = Csv::splitUnquoted(line, fields, 5);
+        bool ok = false;
+        const qint64 sequence = toSequence(fieldCount < 0 ? line.first(std::max<qsizetype>(line.indexOf(','), 0)) : fields[0], &ok);
+        if (!ok || sequence <= afterSeq)
+            return;
+
+        SessionChange change;
+        if (fieldCount >= 5)
+        {
+            if (fields[1] == QByteArrayView("+"))
+                change.op = SessionChange::Op::Insert;
+            else if (fields[1] == QByteArrayView("-"))
+                change.op = SessionChange::Op::Remove;
+            else
+                return;
+            change.session = Session{Csv::fieldToString(fields[2]),
+                                     Timestamp::fromCompact(Csv::trimmedAscii(fields[3])),
+                                     Timestamp::fromCompact(Csv::trimmedAscii(fields[4]))};
+            if (change.session.account.isEmpty())
+                return;
+        }
+        else if (fieldCount >= 0 || !changeFromFields(Csv::parseLine(QString::fromUtf8(line.data(), line.size())), &change))
+        {
+            return;
+        }
+        changes->push_back(std::move(change)); });
+}
+
+void apply(std::vector<Session> &sessions, const std::vector<SessionChange> &changes)
+{
+    if (changes.empty())
+        return;
+
+    // 日志内先增后删的记录直接在新增列表中抵消，其余删除记为墓碑，
+    // 最后对基础记录只做一次遍历
+    std::vector<Session> inserted;
+    QHash<SessionKey, int> tombstones;
+    for (const auto &change : changes)
+    {
+        if (change.op == SessionChange::Op::Insert)
+        {
+            inserted.push_back(change.session);
+            continue;
+        }
+
+        const SessionKey key = keyOf(change.session);
+        auto it = std::find_if(inserted.rbegin(), inserted.rend(), [&](const Session &session)
+                               { return keyOf(session) == key; });
+        if (it != inserted.rend())
+            inserted.erase(std::next(it).base());
+        else
+            ++tombstones[key];
+    }
+
+    if (!tombstones.isEmpty())
+    {
+        sessions.erase(std::remove_if(sessions.begin(), sessions.end(), [&](const Session &session)
+                                      {
+                                          auto it = tombstones.find(keyOf(session));
+                                          if (it == tombstones.end())
+                                              return false;
+                                          if (--it.value() == 0)
+                                              tombstones.erase(it);
+                                          return true; }),
+                       sessions.end());
+    }
+
+    sessions.reserve(sessions.size() + inserted.size());
+    for (auto &session : inserted)
+        sessions.push_back(std::move(session));
+}
+
+QString baseHeaderLine(qint64 sequence)
+{
+    return QString::fromLatin1(kBaseHeaderPrefix) + QString::number(sequence);
+}
+}
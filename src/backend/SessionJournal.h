@@ -0,0 +1,41 @@
+#pragma once
+
+#include "backend/Models.h"
+
+#include <QString>
+
+#include <vector>
+
+// 上网记录的变更
+struct SessionChange
+{
+    enum class Op : char
+    {
+        Insert = '+',
+        Remove = '-'
+    };
+
+    Op op{Op::Insert};
+    Session session;
+};
+
+// 上网记录的追加式日志 sessions.journal：每行一条变更 "seq,op,account,begin,end"，
+// op 为 + 或 -，修改记作先删后增。序号单调递增，sessions.csv 首行以
+// "# journal-seq N" 记录已并入基础文件的最大序号，重放时只应用序号更大的变更，
+// 因此压缩中途崩溃后重复重放也不会出错。末行没有换行符说明写入被中断，整行忽略。
+namespace SessionJournal
+{
+// 基础文件首行记录的序号，没有记录时为 0
+qint64 baseSequence(const QString &basePath);
+// 日志中最后一条完整变更的序号，文件不存在或为空时为 0
+qint64 lastSequence(const QString &journalPath);
+
+// 从 firstSeq 开始依次编号追加；先截去中断写入留下的残行
+bool append(const QString &journalPath, const std::vector<SessionChange> &changes, qint64 firstSeq, QString *error = nullptr);
+// 读出序号大于 afterSeq 的变更，按日志顺序追加到 changes
+void read(const QString &journalPath, qint64 afterSeq, std::vector<SessionChange> *changes);
+// 按顺序应用变更；删除按账号与起止时间匹配，一条删除只移除一条记录
+void apply(std::vector<Session> &sessions, const std::vector<SessionChange> &changes);
+
+QString baseHeaderLine(qint64 sequence);
+}
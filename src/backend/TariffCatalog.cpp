@@ -0,0 +1,131 @@
+#include "backend/TariffCatalog.h"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+namespace
+{
+    struct BuiltinPlan
+    {
+        TariffRate rate;
+        const char16_t *name;
+        const char16_t *description;
+    };
+
+    constexpr BuiltinPlan kBuiltinPlans[] = {
+        {{0, 3, 0}, u"标准计费", u"无优惠：按每分钟 0.03 元计费。"},
+        {{5000, 3, 30 * 60}, u"30 小时套餐", u"每月 50 元含 30 小时，超出部分按每分钟 0.03 元计费。"},
+        {{9500, 3, 60 * 60}, u"60 小时套餐", u"每月 95 元含 60 小时，超出部分按每分钟 0.03 元计费。"},
+        {{20000, 3, 150 * 60}, u"150 小时套餐", u"每月 200 元含 150 小时，超出部分按每分钟 0.03 元计费。"},
+        {{30000, 0, 0}, u"包月不限时", u"每月 300 元，上网时长不限。"},
+    };
+} // namespace
+
+TariffCatalog::TariffCatalog()
+{
+    for (int id = 0; id < static_cast<int>(std::size(kBuiltinPlans)); ++id)
+    {
+        const auto &plan = kBuiltinPlans[id];
+        m_plans.push_back(TariffPlan{id,
+                                     QString::fromUtf16(plan.name),
+                                     Money::fromCents(plan.rate.baseFeeCents),
+                                     plan.rate.includedMinutes,
+                                     Money::fromCents(plan.rate.pricePerMinuteCents),
+                                     QString::fromUtf16(plan.description)});
+    }
+    compile();
+}
+
+TariffCatalog TariffCatalog::builtin()
+{
+    return TariffCatalog();
+}
+
+bool TariffCatalog::fromPlans(std::vector<TariffPlan> plans, TariffCatalog *catalog, QString *error)
+{
+    const auto setError = [&](const QString &msg)
+    {
+        if (error)
+            *error = msg;
+    };
+
+    std::sort(plans.begin(), plans.end(), [](const TariffPlan &a, const TariffPlan &b)
+              { return a.id < b.id; });
+    if (plans.empty() || plans.front().id != 0)
+    {
+        setError(QStringLiteral(u"套餐目录缺少 0 号套餐。"));
+        return false;
+    }
+    for (std::size_t i = 0; i < plans.size(); ++i)
+    {
+        const auto &plan = plans[i];
+        if (plan.id >= kMaxPlans)
+        {
+            setError(QStringLiteral(u"套餐编号超出范围：%1").arg(plan.id));
+            return false;
+        }
+        if (i > 0 && plans[i - 1].id == plan.id)
+        {
+            setError(QStringLiteral(u"套餐编号重复：%1").arg(plan.id));
+            return false;
+        }
+        if (plan.baseFee < Money() || plan.pricePerMinute < Money() || plan.includedMinutes < 0)
+        {
+            setError(QStringLiteral(u"套餐参数不能为负数：%1").arg(plan.id));
+            return false;
+        }
+        if (plan.pricePerMinute.cents() > std::numeric_limits<qint32>::max())
+        {
+            setError(QStringLiteral(u"套餐单价过大：%1").arg(plan.id));
+            return false;
+        }
+    }
+
+    if (catalog)
+    {
+        catalog->m_plans = std::move(plans);
+        catalog->compile();
+    }
+    return true;
+}
+
+bool TariffCatalog::contains(int planId) const
+{
+    return planId >= 0 && planId < static_cast<int>(m_planIndex.size()) && m_planIndex[static_cast<std::size_t>(planId)] >= 0;
+}
+
+QString TariffCatalog::name(int planId) const
+{
+    if (!contains(planId))
+        return QStringLiteral(u"未知套餐");
+    return m_plans[static_cast<std::size_t>(m_planIndex[static_cast<std::size_t>(planId)])].name;
+}
+
+QString TariffCatalog::description(int planId) const
+{
+    if (!contains(planId))
+        return QStringLiteral(u"套餐计费方式未知。");
+    return m_plans[static_cast<std::size_t>(m_planIndex[static_cast<std::size_t>(planId)])].description;
+}
+
+void TariffCatalog::compile()
+{
+    const int size = m_plans.back().id + 1; // 目录总包含 0 号套餐
+    m_planIndex.assign(static_cast<std::size_t>(size), -1);
+    for (std::size_t i = 0; i < m_plans.size(); ++i)
+        m_planIndex[static_cast<std::size_t>(m_plans[i].id)] = static_cast<int>(i);
+
+    // 空缺编号沿用 0 号套餐的费率，保证按编号直接取表项无需分支
+    m_baseFeeCents.assign(static_cast<std::size_t>(size), 0);
+    m_pricePerMinuteCents.assign(static_cast<std::size_t>(size), 0);
+    m_includedMinutes.assign(static_cast<std::size_t>(size), 0);
+    for (int id = 0; id < size; ++id)
+    {
+        const int index = m_planIndex[static_cast<std::size_t>(id)];
+        const TariffPlan &plan = m_plans[static_cast<std::size_t>(index >= 0 ? index : 0)];
+        m_baseFeeCents[static_cast<std::size_t>(id)] = plan.baseFee.cents();
+        m_pricePerMinuteCents[static_cast<std::size_t>(id)] = plan.pricePerMinute.cents();
+        m_includedMinutes[static_cast<std::size_t>(id)] = plan.includedMinutes;
+    }
+}
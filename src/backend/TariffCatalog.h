@@ -0,0 +1,83 @@
+#pragma once
+
+#include "backend/Money.h"
+
+#include <QString>
+#include <algorithm>
+#include <vector>
+
+// 单个套餐的计费参数：费用 = baseFee + pricePerMinute × max(0, 分钟 − includedMinutes)
+struct TariffPlan
+{
+    int id{0};
+    QString name;
+    Money baseFee;
+    int includedMinutes{0};
+    Money pricePerMinute;
+    QString description;
+};
+
+// 单个套餐编译后的费率
+struct TariffRate
+{
+    qint64 baseFeeCents;
+    qint64 pricePerMinuteCents;
+    qint32 includedMinutes;
+};
+
+// 按列存放的费率表，下标为套餐编号，供批量计费内核按编号收集
+struct TariffTable
+{
+    const qint64 *baseFeeCents;
+    const qint64 *pricePerMinuteCents;
+    const qint32 *includedMinutes;
+    int size;
+};
+
+// 套餐目录：可由数据目录中的 tariffs.csv 加载，加载后编译为按编号下标访问的扁平费率表
+class TariffCatalog
+{
+public:
+    static constexpr int kMaxPlans = 256;
+
+    TariffCatalog();
+
+    // 与历史硬编码规则一致的五档套餐
+    static TariffCatalog builtin();
+    // 校验并编译套餐列表；编号须在 [0, kMaxPlans) 内且不重复，且必须包含 0 号套餐，
+    // 每分钟单价不超过 32 位，以便批量内核用 32×32 位乘法
+    static bool fromPlans(std::vector<TariffPlan> plans, TariffCatalog *catalog, QString *error = nullptr);
+
+    int planCount() const { return static_cast<int>(m_includedMinutes.size()); }
+    bool contains(int planId) const;
+    const std::vector<TariffPlan> &plans() const { return m_plans; }
+    TariffTable table() const
+    {
+        return TariffTable{m_baseFeeCents.data(), m_pricePerMinuteCents.data(), m_includedMinutes.data(), planCount()};
+    }
+
+    // 未登记的编号按 0 号套餐计费
+    TariffRate rate(int planId) const
+    {
+        const std::size_t i = (planId >= 0 && planId < planCount()) ? static_cast<std::size_t>(planId) : 0;
+        return TariffRate{m_baseFeeCents[i], m_pricePerMinuteCents[i], m_includedMinutes[i]};
+    }
+    Money fee(int planId, int minutes) const
+    {
+        const TariffRate r = rate(planId);
+        const qint64 overage = std::max<qint64>(0, static_cast<qint64>(minutes) - r.includedMinutes);
+        return Money::fromCents(r.baseFeeCents + r.pricePerMinuteCents * overage);
+    }
+
+    QString name(int planId) const;
+    QString description(int planId) const;
+
+private:
+    void compile();
+
+    std::vector<TariffPlan> m_plans; // 按编号升序
+    std::vector<qint64> m_baseFeeCents; // 以下三列下标均为套餐编号
+    std::vector<qint64> m_pricePerMinuteCents;
+    std::vector<qint32> m_includedMinutes;
+    std::vector<int> m_planIndex;    // 套餐编号 -> m_plans 下标，空缺为 -1
+};
@@ -0,0 +1,198 @@
+#include "backend/Timestamp.h"
+
+namespace
+{
+    bool isLeapYear(int year)
+    {
+        return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    }
+
+    int daysInMonth(int year, int month)
+    {
+        static constexpr int kDays[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+        return month == 2 && isLeapYear(year) ? 29 : kDays[month - 1];
+    }
+
+    // 读取 count 位十进制数字，遇到非数字返回 -1
+    template <typename Char>
+    int digits(const Char *text, int count)
+    {
+        int value = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            const int digit = static_cast<int>(text[i]) - '0';
+            if (digit < 0 || digit > 9)
+                return -1;
+            value = value * 10 + digit;
+        }
+        return value;
+    }
+
+    template <typename Char>
+    bool parseCompactChars(const Char *text, qsizetype size, Timestamp::Civil *civil)
+    {
+        if (size != 14)
+            return false;
+        Timestamp::Civil result{digits(text, 4), digits(text + 4, 2), digits(text + 6, 2),
+                                digits(text + 8, 2), digits(text + 10, 2), digits(text + 12, 2)};
+        if (!Timestamp::isValid(result))
+            return false;
+        *civil = result;
+        return true;
+    }
+
+    template <typename Char>
+    void writeDigits(int value, int count, Char *out)
+    {
+        for (int i = count - 1; i >= 0; --i)
+        {
+            out[i] = static_cast<Char>('0' + value % 10);
+            value /= 10;
+        }
+    }
+
+    template <typename Char>
+    void writeCompactChars(const Timestamp::Civil &civil, Char *out)
+    {
+        writeDigits(civil.year, 4, out);
+        writeDigits(civil.month, 2, out + 4);
+        writeDigits(civil.day, 2, out + 6);
+        writeDigits(civil.hour, 2, out + 8);
+        writeDigits(civil.minute, 2, out + 10);
+        writeDigits(civil.second, 2, out + 12);
+    }
+
+    template <typename Char>
+    void writeIsoChars(const Timestamp::Civil &civil, Char *out)
+    {
+        writeDigits(civil.year, 4, out);
+        out[4] = '-';
+        writeDigits(civil.month, 2, out + 5);
+        out[7] = '-';
+        writeDigits(civil.day, 2, out + 8);
+        out[10] = 'T';
+        writeDigits(civil.hour, 2, out + 11);
+        out[13] = ':';
+        writeDigits(civil.minute, 2, out + 14);
+        out[16] = ':';
+        writeDigits(civil.second, 2, out + 17);
+    }
+} // namespace
+
+namespace Timestamp
+{
+bool isValid(const Civil &civil)
+{
+    // 与 QDate 一致，不存在公元 0 年；四位数字格式上限为 9999 年
+    return civil.year >= 1 && civil.year <= 9999
+           && civil.month >= 1 && civil.month <= 12
+           && civil.day >= 1 && civil.day <= daysInMonth(civil.year, civil.month)
+           && civil.hour >= 0 && civil.hour < 24
+           && civil.minute >= 0 && civil.minute < 60
+           && civil.second >= 0 && civil.second < 60;
+}
+
+bool parseCompact(QByteArrayView text, Civil *civil)
+{
+    return parseCompactChars(text.data(), text.size(), civil);
+}
+
+bool parseCompact(QStringView text, Civil *civil)
+{
+    return parseCompactChars(text.utf16(), text.size(), civil);
+}
+
+bool parseIso(QStringView text, Civil *civil)
+{
+    if (text.size() != 19 || text[4] != u'-' || text[7] != u'-' || text[10] != u'T' || text[13] != u':' || text[16] != u':')
+        return false;
+    const char16_t *chars = text.utf16();
+    Civil result{digits(chars, 4), digits(chars + 5, 2), digits(chars + 8, 2),
+                 digits(chars + 11, 2), digits(chars + 14, 2), digits(chars + 17, 2)};
+    if (!isValid(result))
+        return false;
+    *civil = result;
+    return true;
+}
+
+QDateTime toDateTime(const Civil &civil)
+{
+    return QDateTime(QDate(civil.year, civil.month, civil.day), QTime(civil.hour, civil.minute, civil.second));
+}
+
+Civil fromDateTime(const QDateTime &dateTime)
+{
+    const QDate date = dateTime.date();
+    const QTime time = dateTime.time();
+    return Civil{date.year(), date.month(), date.day(), time.hour(), time.minute(), time.second()};
+}
+
+void writeCompact(const Civil &civil, char16_t *out)
+{
+    writeCompactChars(civil, out);
+}
+
+void writeCompact(const Civil &civil, char *out)
+{
+    writeCompactChars(civil, out);
+}
+
+void writeIso(const Civil &civil, char16_t *out)
+{
+    writeIsoChars(civil, out);
+}
+
+void writeIso(const Civil &civil, char *out)
+{
+    writeIsoChars(civil, out);
+}
+
+QDateTime fromCompact(QByteArrayView text)
+{
+    Civil civil;
+    if (parseCompact(text, &civil))
+        return toDateTime(civil);
+    return QDateTime::fromString(QString::fromUtf8(text.data(), text.size()).trimmed(), QStringLiteral("yyyyMMddHHmmss"));
+}
+
+QDateTime fromCompact(QStringView text)
+{
+    Civil civil;
+    if (parseCompact(text, &civil))
+        return toDateTime(civil);
+    return QDateTime::fromString(text.toString(), QStringLiteral("yyyyMMddHHmmss"));
+}
+
+QDateTime fromIso(QStringView text)
+{
+    Civil civil;
+    if (parseIso(text, &civil))
+        return toDateTime(civil);
+    return QDateTime::fromString(text.toString(), Qt::ISODate);
+}
+
+QString toCompact(const QDateTime &dateTime)
+{
+    if (!dateTime.isValid())
+        return QString();
+    const Civil civil = fromDateTime(dateTime);
+    if (civil.year < 1 || civil.year > 9999)
+        return dateTime.toString(QStringLiteral("yyyyMMddHHmmss"));
+    char16_t buffer[14];
+    writeCompact(civil, buffer);
+    return QString(reinterpret_cast<const QChar *>(buffer), 14);
+}
+
+QString toIso(const QDateTime &dateTime)
+{
+    // 本地时间的 Qt::ISODate 输出固定为 19 个字符（不含毫秒与时区后缀），其余情况沿用 Qt
+    if (!dateTime.isValid() || dateTime.timeSpec() != Qt::LocalTime)
+        return dateTime.toString(Qt::ISODate);
+    const Civil civil = fromDateTime(dateTime);
+    if (civil.year < 1 || civil.year > 9999)
+        return dateTime.toString(Qt::ISODate);
+    char16_t buffer[19];
+    writeIso(civil, buffer);
+    return QString(reinterpret_cast<const QChar *>(buffer), 19);
+}
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <QByteArrayView>
+#include <QDateTime>
+#include <QString>
+#include <QStringView>
+
+// 数据文件中固定格式时间戳的编解码：紧凑格式 yyyyMMddHHmmss（上网记录）与
+// ISO 格式 yyyy-MM-ddTHH:mm:ss（充值记录）。按位数字运算并做合法性校验，
+// 只在需要 QDateTime 时才构造一次；不符合固定格式的文本交给 QDateTime::fromString，
+// 因此结果与原先按格式串解析一致。
+namespace Timestamp
+{
+// 本地墙钟时间，不含时区信息
+struct Civil
+{
+    int year{0};
+    int month{0};
+    int day{0};
+    int hour{0};
+    int minute{0};
+    int second{0};
+};
+
+bool isValid(const Civil &civil);
+
+// 严格按固定宽度解析，格式或数值不合法时返回 false
+bool parseCompact(QByteArrayView text, Civil *civil);
+bool parseCompact(QStringView text, Civil *civil);
+bool parseIso(QStringView text, Civil *civil);
+
+QDateTime toDateTime(const Civil &civil);
+Civil fromDateTime(const QDateTime &dateTime);
+
+// 写出 14 / 19 个字符，调用方保证缓冲区足够
+void writeCompact(const Civil &civil, char16_t *out);
+void writeCompact(const Civil &civil, char *out);
+void writeIso(const Civil &civil, char16_t *out);
+void writeIso(const Civil &civil, char *out);
+
+// Repository 读写使用的入口；字节形式的输入按 UTF-8 解码，走通用解析时忽略首尾空白
+QDateTime fromCompact(QByteArrayView text);
+QDateTime fromCompact(QStringView text);
+QDateTime fromIso(QStringView text);
+QString toCompact(const QDateTime &dateTime);
+QString toIso(const QDateTime &dateTime);
+}
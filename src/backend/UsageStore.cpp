@@ -0,0 +1,80 @@
+#include "backend/UsageStore.h"
+
+#include "backend/Billing.h"
+
+#include <algorithm>
+
+void UsageStore::clear()
+{
+    m_minutes.clear();
+}
+
+void UsageStore::rebuild(const std::vector<Session> &sessions)
+{
+    m_minutes.clear();
+    for (const auto &session : sessions)
+        apply(session, 1);
+}
+
+void UsageStore::addSession(const Session &session)
+{
+    apply(session, 1);
+}
+
+void UsageStore::removeSession(const Session &session)
+{
+    apply(session, -1);
+}
+
+int UsageStore::minutes(AccountId account, int year, int month) const
+{
+    if (account >= m_minutes.size())
+        return 0;
+    const auto &months = m_minutes[account];
+    const auto it = months.find(monthKey(year, month));
+    return it == months.end() ? 0 : it->second;
+}
+
+bool UsageStore::matches(const std::vector<Session> &sessions) const
+{
+    UsageStore fresh;
+    fresh.rebuild(sessions);
+    return fresh == *this;
+}
+
+bool UsageStore::operator==(const UsageStore &other) const
+{
+    // 末尾的空表不影响比较结果
+    const std::size_t common = std::min(m_minutes.size(), other.m_minutes.size());
+    for (std::size_t i = 0; i < common; ++i)
+    {
+        if (m_minutes[i] != other.m_minutes[i])
+            return false;
+    }
+    const auto &longer = m_minutes.size() > other.m_minutes.size() ? m_minutes : other.m_minutes;
+    for (std::size_t i = common; i < longer.size(); ++i)
+    {
+        if (!longer[i].empty())
+            return false;
+    }
+    return true;
+}
+
+void UsageStore::apply(const Session &session, int sign)
+{
+    if (session.accountId == kInvalidAccountId)
+        return;
+    if (session.accountId >= m_minutes.size())
+        m_minutes.resize(static_cast<std::size_t>(session.accountId) + 1);
+
+    auto &months = m_minutes[session.accountId];
+    BillingEngine::splitByMonth(session.begin, session.end, [&](int year, int month, int mins)
+                                {
+        const int key = monthKey(year, month);
+        const int updated = months[key] + sign * mins;
+        // 归零的条目直接移除，保证与重建结果逐项相等
+        if (updated == 0)
+            months.erase(key);
+        else
+            months[key] = updated; });
+}
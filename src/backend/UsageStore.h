@@ -0,0 +1,32 @@
+#pragma once
+
+#include "backend/Models.h"
+
+#include <unordered_map>
+
+// 按 (账号编号, 月份) 维护的上网分钟汇总，会话增删改时增量更新，
+// 结算某月账单时只需遍历用户而无需重新扫描全部会话。
+// 会话需已由 AccountDirectory 分配 accountId，未分配的会话会被忽略。
+class UsageStore
+{
+public:
+    void clear();
+    void rebuild(const std::vector<Session> &sessions);
+
+    void addSession(const Session &session);
+    void removeSession(const Session &session);
+
+    int minutes(AccountId account, int year, int month) const;
+
+    // 一致性检查：由 sessions 重建一份汇总并与当前内容逐项比较
+    bool matches(const std::vector<Session> &sessions) const;
+
+    bool operator==(const UsageStore &other) const;
+    bool operator!=(const UsageStore &other) const { return !(*this == other); }
+
+private:
+    static int monthKey(int year, int month) { return year * 12 + (month - 1); }
+    void apply(const Session &session, int sign);
+
+    std::vector<std::unordered_map<int, int>> m_minutes; // 下标为 AccountId
+};
@@ -0,0 +1,217 @@
+#include "backend/WriteAheadLog.h"
+
+#include "backend/Csv.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include <algorithm>
+#include <utility>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+    // QFile::flush 只把数据交给系统，崩溃或断电后仍可能丢失，需要再同步到磁盘
+    bool syncToDisk(QFile &file)
+    {
+        if (!file.flush())
+            return false;
+#ifdef Q_OS_WIN
+        return _commit(file.handle()) == 0;
+#else
+        return ::fsync(file.handle()) == 0;
+#endif
+    }
+
+    // 字段经 encodeField 写出，可能含带引号的换行，须按 CSV 记录而不是按行判断写入是否完整
+    QByteArrayView completeRecords(QByteArrayView data)
+    {
+        return data.first(Csv::completeRecordsLength(data));
+    }
+
+    qint64 leadingSequence(QByteArrayView line, bool *ok)
+    {
+        const qsizetype comma = line.indexOf(',');
+        const QByteArrayView field = Csv::trimmedAscii(comma < 0 ? line : line.first(comma));
+        return QByteArray(field.data(), field.size()).toLongLong(ok);
+    }
+} // namespace
+
+WriteAheadLog::WriteAheadLog(QString path, QString basePath, QByteArray tag)
+    : m_path(std::move(path)), m_basePath(std::move(basePath)), m_tag(std::move(tag)), m_current(std::make_shared<Batch>())
+{
+}
+
+bool WriteAheadLog::append(const std::vector<QStringList> &records, QString *error)
+{
+    if (records.empty())
+        return true;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_nextSequence == 0)
+        m_nextSequence = std::max(baseSequence(), lastSequence()) + 1;
+
+    QByteArray &data = m_current->data;
+    for (const QStringList &fields : records)
+    {
+        data += QByteArray::number(m_nextSequence++);
+        for (const QString &field : fields)
+        {
+            data += ',';
+            data += Csv::encodeField(field).toUtf8();
+        }
+        data += '\n';
+    }
+
+    const std::shared_ptr<Batch> batch = m_current;
+    while (!batch->done)
+    {
+        if (m_flushing)
+        {
+            m_flushed.wait(lock);
+            continue;
+        }
+
+        // 没有正在进行的写入时由当前线程接手，期间到达的记录进入下一批
+        m_flushing = true;
+        const std::shared_ptr<Batch> flushing = std::exchange(m_current, std::make_shared<Batch>());
+        lock.unlock();
+        QString flushError;
+        const bool ok = writeBatch(flushing->data, &flushError);
+        lock.lock();
+        flushing->ok = ok;
+        flushing->error = flushError;
+        flushing->done = true;
+        m_flushing = false;
+        m_flushed.notify_all();
+    }
+
+    if (!batch->ok && error)
+        *error = batch->error;
+    return batch->ok;
+}
+
+bool WriteAheadLog::checkpoint(const std::function<bool(qint64 sequence)> &writeBase)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_flushed.wait(lock, [&]
+                   { return !m_flushing && m_current->data.isEmpty(); });
+    if (m_nextSequence == 0)
+        m_nextSequence = std::max(baseSequence(), lastSequence()) + 1;
+
+    if (!writeBase(m_nextSequence - 1))
+        return false;
+    QFile::remove(m_path);
+    m_tailChecked = true;
+    return true;
+}
+
+std::vector<QStringList> WriteAheadLog::read() const
+{
+    std::vector<QStringList> records;
+    Csv::MappedFile file(m_path);
+    if (!file.isOpen())
+        return records;
+
+    const qint64 after = baseSequence();
+    Csv::forEachRecord(completeRecords(file.data()), [&](QByteArrayView line)
+                       {
+        bool ok = false;
+        const qint64 sequence = leadingSequence(line, &ok);
+        if (!ok || sequence <= after)
+            return;
+        QStringList fields = Csv::parseLine(QString::fromUtf8(line.data(), line.size()));
+        fields.removeFirst();
+        records.push_back(std::move(fields)); });
+    return records;
+}
+
+void WriteAheadLog::reset()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_flushed.wait(lock, [&]
+                   { return !m_flushing && m_current->data.isEmpty(); });
+    m_nextSequence = 0;
+    m_tailChecked = false;
+}
+
+qint64 WriteAheadLog::size() const
+{
+    return QFileInfo(m_path).size();
+}
+
+QString WriteAheadLog::baseHeaderLine(qint64 sequence) const
+{
+    return QStringLiteral("# %1 %2").arg(QString::fromLatin1(m_tag)).arg(sequence);
+}
+
+qint64 WriteAheadLog::baseSequence() const
+{
+    QFile file(m_basePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return 0;
+
+    QByteArray line = file.readLine(256);
+    if (line.startsWith("\xEF\xBB\xBF"))
+        line.remove(0, 3);
+    const QByteArray prefix = "# " + m_tag + ' ';
+    if (!line.startsWith(prefix))
+        return 0;
+    bool ok = false;
+    const qint64 sequence = line.mid(prefix.size()).trimmed().toLongLong(&ok);
+    return ok ? sequence : 0;
+}
+
+qint64 WriteAheadLog::lastSequence() const
+{
+    Csv::MappedFile file(m_path);
+    if (!file.isOpen())
+        return 0;
+
+    qint64 sequence = 0;
+    Csv::forEachRecord(completeRecords(file.data()), [&](QByteArrayView line)
+                       {
+        bool ok = false;
+        const qint64 value = leadingSequence(line, &ok);
+        if (ok)
+            sequence = std::max(sequence, value); });
+    return sequence;
+}
+
+bool WriteAheadLog::writeBatch(const QByteArray &data, QString *error)
+{
+    QDir().mkpath(QFileInfo(m_path).path());
+    QFile file(m_path);
+    if (!file.open(QIODevice::ReadWrite))
+    {
+        *error = QStringLiteral(u"无法打开日志文件：%1").arg(QDir::toNativeSeparators(m_path));
+        return false;
+    }
+
+    // 上次写入中断留下的残缺记录要先截掉，否则会与本批第一条记录连成一条
+    if (!m_tailChecked)
+    {
+        const QByteArray existing = file.readAll();
+        const qsizetype complete = completeRecords(existing).size();
+        if (complete != existing.size() && !file.resize(complete))
+        {
+            *error = QStringLiteral(u"无法修复日志文件：%1").arg(QDir::toNativeSeparators(m_path));
+            return false;
+        }
+        m_tailChecked = true;
+    }
+
+    if (!file.seek(file.size()) || file.write(data) != data.size() || !syncToDisk(file))
+    {
+        *error = QStringLiteral(u"写入日志文件失败：%1").arg(QDir::toNativeSeparators(m_path));
+        m_tailChecked = false;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// 基础文件旁的预写日志：每行为 "seq,字段..." 的 CSV 记录，追加后立即落盘（fsync）。
+// 基础文件首行以 "# <tag> N" 记录已并入的最大序号，读取时只返回序号更大的记录，
+// 因此检查点写完基础文件后、删除日志前崩溃也不会重复应用。
+// 多个线程同时 append 时采用组提交：先到者负责把等待中的记录合并成一次写入和一次 fsync。
+class WriteAheadLog
+{
+public:
+    WriteAheadLog(QString path, QString basePath, QByteArray tag);
+    WriteAheadLog(const WriteAheadLog &) = delete;
+    WriteAheadLog &operator=(const WriteAheadLog &) = delete;
+
+    // records 中每项为一条记录的字段（不含序号），整批落盘后返回
+    bool append(const std::vector<QStringList> &records, QString *error = nullptr);
+    // 持锁期间以当前最大序号调用 writeBase 写入基础文件，成功后删除日志
+    bool checkpoint(const std::function<bool(qint64 sequence)> &writeBase);
+    // 基础文件尚未包含的记录（不含序号），按写入顺序排列；末尾未写完的残行被忽略
+    std::vector<QStringList> read() const;
+    // 基础文件被外部替换（如恢复备份）后调用，下次 append 重新确定序号
+    void reset();
+
+    qint64 size() const;
+    QString path() const { return m_path; }
+    QString baseHeaderLine(qint64 sequence) const;
+
+private:
+    struct Batch
+    {
+        QByteArray data;
+        bool done{false};
+        bool ok{false};
+        QString error;
+    };
+
+    qint64 baseSequence() const;
+    qint64 lastSequence() const;
+    bool writeBatch(const QByteArray &data, QString *error);
+
+    QString m_path;
+    QString m_basePath;
+    QByteArray m_tag;
+
+    std::mutex m_mutex;
+    std::condition_variable m_flushed;
+    std::shared_ptr<Batch> m_current;
+    bool m_flushing{false};
+    qint64 m_nextSequence{0}; // 0 表示尚未从文件确定
+    bool m_tailChecked{false};
+};
@@ -1,5 +1,10 @@
 #include "Billing.h"
+#include "backend/AccountDirectory.h"
+#include "backend/FeeKernel.h"
+#include "backend/UsageStore.h"
 #include <QDate>
+#include <QHash>
+#include <algorithm>
 
 static QDateTime clampBegin(int y, int m, const QDateTime &dt)
 {
@@ -15,6 +20,10 @@ static QDateTime clampEnd(int y, int m, const QDateTime &dt)
 
 int BillingEngine::minutesInMonthPortion(const QDateTime &b, const QDateTime &e, int y, int m)
 {
+    // 起止时间无效的会话不计费，与按秒计算的版本一致
+    if (!b.isValid() || !e.isValid())
+        return 0;
+
     // 计算该会话在指定年月内的秒数并向上取整到分钟
     auto cb = clampBegin(y, m, b);
     auto ce = clampEnd(y, m, e);
@@ -37,36 +46,54 @@ int BillingEngine::minutesInMonthPortion(const QDateTime &b, const QDateTime &e,
     return mins;
 }
 
-int BillingEngine::includedMinutes(Tariff t)
+int BillingEngine::minutesInMonthPortion(qint64 b, qint64 e, qint64 monthBegin, qint64 monthLast)
 {
-    switch (t)
-    {
-    case Tariff::Pack30h:
-        return 30 * 60;
-    case Tariff::Pack60h:
-        return 60 * 60;
-    case Tariff::Pack150h:
-        return 150 * 60;
-    default:
+    // 与 QDateTime 版本保持一致：结束时间裁剪到当月最后一天 23:59:59
+    const qint64 cb = b > monthBegin ? b : monthBegin;
+    const qint64 ce = e < monthLast ? e : monthLast;
+    const qint64 secs = ce - cb;
+    if (secs <= 0)
         return 0;
+    return static_cast<int>((secs + 59) / 60);
+}
+
+SessionColumns SessionColumns::fromSessions(const std::vector<Session> &sessions)
+{
+    SessionColumns columns;
+    columns.accountIndex.reserve(sessions.size());
+    columns.beginSecs.reserve(sessions.size());
+    columns.endSecs.reserve(sessions.size());
+
+    std::unordered_map<QString, std::uint32_t> indexOf;
+    for (const auto &s : sessions)
+    {
+        auto [it, inserted] = indexOf.try_emplace(s.account, static_cast<std::uint32_t>(columns.accounts.size()));
+        if (inserted)
+            columns.accounts.push_back(s.account);
+        columns.accountIndex.push_back(it->second);
+        columns.beginSecs.push_back(beginSecsOf(s.begin));
+        columns.endSecs.push_back(endSecsOf(s.end));
     }
+    return columns;
 }
-double BillingEngine::baseFee(Tariff t)
+
+namespace
 {
-    switch (t)
+    TariffCatalog &currentTariffs()
     {
-    case Tariff::NoDiscount:
-        return 0.0;
-    case Tariff::Pack30h:
-        return 50.0;
-    case Tariff::Pack60h:
-        return 95.0;
-    case Tariff::Pack150h:
-        return 200.0;
-    case Tariff::Unlimited:
-        return 300.0;
+        static TariffCatalog catalog = TariffCatalog::builtin();
+        return catalog;
     }
-    return 0.0;
+} // namespace
+
+const TariffCatalog &BillingEngine::tariffs()
+{
+    return currentTariffs();
+}
+
+void BillingEngine::setTariffs(TariffCatalog catalog)
+{
+    currentTariffs() = std::move(catalog);
 }
 
 std::vector<BillLine> BillingEngine::computeMonthly(
@@ -80,7 +107,7 @@ std::vector<BillLine> BillingEngine::computeMonthly(
     for (auto &u : users)
     {
         planOf[u.account] = u.plan;
-        map[u.account] = BillLine{u.account, u.name, static_cast<int>(u.plan), 0, 0.0};
+        map[u.account] = BillLine{u.account, u.name, static_cast<int>(u.plan), 0, Money()};
     }
 
     // 汇总分钟
@@ -94,33 +121,252 @@ std::vector<BillLine> BillingEngine::computeMonthly(
             map[s.account].minutes += mins;
     }
 
+    return finalize(map);
+}
+
+std::vector<BillLine> BillingEngine::computeMonthly(
+    int year, int month,
+    const std::vector<User> &users,
+    const SessionColumns &sessions)
+{
+    // 月边界只计算一次，之后逐条会话仅做整数比较
+    const QDate first(year, month, 1);
+    const QDate last = first.addMonths(1).addDays(-1);
+    const qint64 monthBegin = QDateTime(first, QTime(0, 0, 0)).toSecsSinceEpoch();
+    const qint64 monthLast = QDateTime(last, QTime(23, 59, 59)).toSecsSinceEpoch();
+
+    std::unordered_map<QString, BillLine> map;
+    for (auto &u : users)
+        map[u.account] = BillLine{u.account, u.name, static_cast<int>(u.plan), 0, Money()};
+
+    // 稠密索引 -> 账单行；未注册的账号为空指针
+    std::vector<BillLine *> lineOf(sessions.accounts.size(), nullptr);
+    for (std::size_t i = 0; i < sessions.accounts.size(); ++i)
+    {
+        auto it = map.find(sessions.accounts[i]);
+        if (it != map.end())
+            lineOf[i] = &it->second;
+    }
+
+    std::vector<int> minutes(sessions.accounts.size(), 0);
+    const std::size_t count = sessions.size();
+    for (std::size_t i = 0; i < count; ++i)
+        minutes[sessions.accountIndex[i]] += minutesInMonthPortion(sessions.beginSecs[i], sessions.endSecs[i], monthBegin, monthLast);
+
+    for (std::size_t i = 0; i < lineOf.size(); ++i)
+    {
+        if (lineOf[i])
+            lineOf[i]->minutes += minutes[i];
+    }
+
+    return finalize(map);
+}
+
+std::vector<BillLine> BillingEngine::computeMonthly(
+    int year, int month,
+    const std::vector<User> &users,
+    const AccountDirectory &accounts,
+    const UsageStore &usage)
+{
+    std::unordered_map<QString, BillLine> map;
+    for (auto &u : users)
+        map[u.account] = BillLine{u.account, u.name, static_cast<int>(u.plan), 0, Money()};
+    for (auto &[acc, bl] : map)
+        bl.minutes = usage.minutes(accounts.find(acc), year, month);
+    return finalize(map);
+}
+
+void BillingEngine::splitByMonth(const QDateTime &begin, const QDateTime &end,
+                                 const std::function<void(int, int, int)> &visit)
+{
+    if (!begin.isValid() || !end.isValid() || end <= begin)
+        return;
+    const qint64 b = begin.toSecsSinceEpoch();
+    const qint64 e = end.toSecsSinceEpoch();
+    const QDate last(end.date().year(), end.date().month(), 1);
+    for (QDate m(begin.date().year(), begin.date().month(), 1); m <= last; m = m.addMonths(1))
+    {
+        const qint64 monthBegin = QDateTime(m, QTime(0, 0, 0)).toSecsSinceEpoch();
+        const qint64 monthLast = QDateTime(m.addMonths(1).addDays(-1), QTime(23, 59, 59)).toSecsSinceEpoch();
+        const int mins = minutesInMonthPortion(b, e, monthBegin, monthLast);
+        if (mins > 0)
+            visit(m.year(), m.month(), mins);
+    }
+}
+
+BillMatrix BillingEngine::computeRange(
+    const QDate &fromMonth, const QDate &toMonth,
+    const std::vector<User> &users,
+    const std::vector<Session> &sessions)
+{
+    BillMatrix matrix;
+    const QDate first(fromMonth.year(), fromMonth.month(), 1);
+    const QDate last(toMonth.year(), toMonth.month(), 1);
+    if (!first.isValid() || !last.isValid() || last < first)
+        return matrix;
+
+    // 每月边界：monthBegin[k] 为第 k 月 1 号 00:00:00，monthLast[k] 为当月最后一天 23:59:59
+    std::vector<qint64> monthBegin;
+    std::vector<qint64> monthLast;
+    for (QDate m = first; m <= last; m = m.addMonths(1))
+    {
+        matrix.months.push_back(m);
+        monthBegin.push_back(QDateTime(m, QTime(0, 0, 0)).toSecsSinceEpoch());
+        const QDate lastDay = m.addMonths(1).addDays(-1);
+        monthLast.push_back(QDateTime(lastDay, QTime(23, 59, 59)).toSecsSinceEpoch());
+    }
+    const std::size_t monthCount = matrix.months.size();
+
+    // 列模板：与 computeMonthly 相同的去重规则（同账号以后出现者为准）
+    std::unordered_map<QString, BillLine> map;
+    for (auto &u : users)
+        map[u.account] = BillLine{u.account, u.name, static_cast<int>(u.plan), 0, Money()};
+    std::vector<BillLine> columns;
+    columns.reserve(map.size());
+    for (auto &[acc, bl] : map)
+        columns.push_back(bl);
+    std::sort(columns.begin(), columns.end(), [](const BillLine &a, const BillLine &b)
+              { return a.account < b.account; });
+
+    std::unordered_map<QString, std::size_t> columnOf;
+    matrix.accounts.reserve(columns.size());
+    for (std::size_t c = 0; c < columns.size(); ++c)
+    {
+        columnOf.emplace(columns[c].account, c);
+        matrix.accounts.push_back(columns[c].account);
+    }
+    const std::size_t accountCount = columns.size();
+
+    // 汇总分钟：每条会话只从其开始所在月份向后拆分到结束所在月份
+    std::vector<int> minutes(monthCount * accountCount, 0);
+    for (auto &s : sessions)
+    {
+        auto it = columnOf.find(s.account);
+        if (it == columnOf.end())
+            continue;
+        const qint64 b = beginSecsOf(s.begin);
+        const qint64 e = endSecsOf(s.end);
+        auto k = static_cast<std::size_t>(std::lower_bound(monthLast.begin(), monthLast.end(), b) - monthLast.begin());
+        for (; k < monthCount && monthBegin[k] < e; ++k)
+            minutes[k * accountCount + it->second] += minutesInMonthPortion(b, e, monthBegin[k], monthLast[k]);
+    }
+
+    // 计费
+    matrix.cells.reserve(monthCount * accountCount);
+    for (std::size_t k = 0; k < monthCount; ++k)
+    {
+        for (std::size_t c = 0; c < accountCount; ++c)
+        {
+            BillLine bl = columns[c];
+            bl.minutes = minutes[k * accountCount + c];
+            matrix.cells.push_back(std::move(bl));
+        }
+    }
+    priceLines(matrix.cells, tariffs());
+    return matrix;
+}
+
+int BillMatrix::columnOf(const QString &account, Qt::CaseSensitivity cs) const
+{
+    if (cs == Qt::CaseSensitive)
+    {
+        auto it = std::lower_bound(accounts.begin(), accounts.end(), account);
+        if (it != accounts.end() && *it == account)
+            return static_cast<int>(it - accounts.begin());
+        return -1;
+    }
+    for (int c = 0; c < accountCount(); ++c)
+    {
+        if (accounts[static_cast<std::size_t>(c)].compare(account, cs) == 0)
+            return c;
+    }
+    return -1;
+}
+
+std::vector<BillLine> BillMatrix::monthLines(int monthRow) const
+{
+    const auto begin = cells.begin() + static_cast<std::ptrdiff_t>(static_cast<std::size_t>(monthRow) * accounts.size());
+    return std::vector<BillLine>(begin, begin + static_cast<std::ptrdiff_t>(accounts.size()));
+}
+
+void BillingEngine::priceLines(std::vector<BillLine> &lines, const TariffCatalog &catalog)
+{
+    // 拆成列交给批量内核，避免逐行按套餐分支
+    const std::size_t count = lines.size();
+    std::vector<qint32> plans(count);
+    std::vector<qint32> minutes(count);
+    std::vector<qint64> amounts(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        plans[i] = lines[i].plan;
+        minutes[i] = lines[i].minutes;
+    }
+    FeeKernel::compute(catalog.table(), plans.data(), minutes.data(), amounts.data(), count);
+    for (std::size_t i = 0; i < count; ++i)
+        lines[i].amount = Money::fromCents(amounts[i]);
+}
+
+std::vector<BillLine> BillingEngine::finalize(std::unordered_map<QString, BillLine> &map)
+{
     // 计费
     std::vector<BillLine> out;
     out.reserve(map.size());
     for (auto &[acc, bl] : map)
+        out.push_back(bl);
+    priceLines(out, tariffs());
+    // 可按账号排序
+    std::sort(out.begin(), out.end(), [](const BillLine &a, const BillLine &b)
+              { return a.account < b.account; });
+    return out;
+}
+
+MonthlyAccumulator::MonthlyAccumulator(int year, int month, const std::vector<User> &users)
+{
+    const QDate first(year, month, 1);
+    const QDate last = first.addMonths(1).addDays(-1);
+    m_monthBegin = QDateTime(first, QTime(0, 0, 0)).toSecsSinceEpoch();
+    m_monthLast = QDateTime(last, QTime(23, 59, 59)).toSecsSinceEpoch();
+
+    // 账号按 AccountDirectory 的规则折叠大小写，与内存中按 UsageStore 结算的结果一致；
+    // 重复账号以后出现的用户信息为准
+    m_lines.reserve(users.size());
+    for (const auto &u : users)
     {
-        Tariff t = static_cast<Tariff>(bl.plan);
-        double fee = 0.0;
-        if (t == Tariff::NoDiscount)
-        {
-            fee = bl.minutes * pricePerMinute();
-        }
-        else if (t == Tariff::Unlimited)
+        BillLine line{u.account, u.name, static_cast<int>(u.plan), 0, Money()};
+        const QString key = AccountDirectory::foldKey(u.account);
+        auto it = m_slots.constFind(key);
+        if (it != m_slots.cend())
         {
-            fee = baseFee(t);
-        }
-        else
-        {
-            fee = baseFee(t);
-            int inc = includedMinutes(t);
-            if (bl.minutes > inc)
-                fee += (bl.minutes - inc) * pricePerMinute();
+            m_lines[static_cast<std::size_t>(*it)] = std::move(line);
+            continue;
         }
-        bl.amount = std::max(0.0, fee);
-        out.push_back(bl);
+        m_slots.insert(key, static_cast<int>(m_lines.size()));
+        m_lines.push_back(std::move(line));
     }
-    // 可按账号排序
+}
+
+int MonthlyAccumulator::slotOf(const QString &account) const
+{
+    return m_slots.value(AccountDirectory::foldKey(account), -1);
+}
+
+void MonthlyAccumulator::add(int slot, qint64 beginSecs, qint64 endSecs, int sign)
+{
+    if (slot < 0 || slot >= static_cast<int>(m_lines.size()))
+        return;
+    m_lines[static_cast<std::size_t>(slot)].minutes += sign * BillingEngine::minutesInMonthPortion(beginSecs, endSecs, m_monthBegin, m_monthLast);
+}
+
+void MonthlyAccumulator::add(const Session &session, int sign)
+{
+    add(slotOf(session.account), beginSecsOf(session.begin), endSecsOf(session.end), sign);
+}
+
+std::vector<BillLine> MonthlyAccumulator::finish() const
+{
+    std::vector<BillLine> out = m_lines;
+    BillingEngine::priceLines(out, BillingEngine::tariffs());
     std::sort(out.begin(), out.end(), [](const BillLine &a, const BillLine &b)
               { return a.account < b.account; });
     return out;
-}
\ No newline at end of file
+}
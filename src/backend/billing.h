@@ -1,18 +1,123 @@
 #pragma once
 #include "Models.h"
+#include "backend/TariffCatalog.h"
+#include <QDate>
+#include <QHash>
+#include <cstdint>
+#include <functional>
 #include <unordered_map>
 
+class AccountDirectory;
+class UsageStore;
+
+// 列式表示中无效起止时间的取值：开始取极大、结束取极小，
+// 按秒裁剪时该会话在任何月份都计 0 分钟，且相减不会溢出；起止时间无效的会话在各条路径上都不计费
+inline constexpr qint64 kInvalidBeginSecs = qint64(1) << 62;
+inline constexpr qint64 kInvalidEndSecs = -(qint64(1) << 62);
+
+// 会话起止时间转为 UTC 纪元秒，无效时间取上面的哨兵值；按秒计费的路径都经由这两个函数
+inline qint64 beginSecsOf(const QDateTime &begin)
+{
+    return begin.isValid() ? begin.toSecsSinceEpoch() : kInvalidBeginSecs;
+}
+inline qint64 endSecsOf(const QDateTime &end)
+{
+    return end.isValid() ? end.toSecsSinceEpoch() : kInvalidEndSecs;
+}
+
+// 会话的列式表示：账号按出现顺序压成稠密索引，起止时间为 UTC 纪元秒
+struct SessionColumns
+{
+    std::vector<QString> accounts;           // 稠密索引 -> 账号
+    std::vector<std::uint32_t> accountIndex; // 每条会话所属账号的稠密索引
+    std::vector<qint64> beginSecs;           // 开始时间（UTC 秒）
+    std::vector<qint64> endSecs;             // 结束时间（UTC 秒）
+
+    std::size_t size() const { return accountIndex.size(); }
+    static SessionColumns fromSessions(const std::vector<Session> &sessions);
+};
+
+// 多月账单矩阵：行为月份，列为按账号排序的用户，行优先存储
+struct BillMatrix
+{
+    std::vector<QDate> months;     // 每行对应月份（当月 1 号）
+    std::vector<QString> accounts; // 每列对应账号，升序
+    std::vector<BillLine> cells;   // months.size() * accounts.size()
+
+    int monthCount() const { return static_cast<int>(months.size()); }
+    int accountCount() const { return static_cast<int>(accounts.size()); }
+    const BillLine &at(int monthRow, int accountColumn) const
+    {
+        return cells[static_cast<std::size_t>(monthRow) * accounts.size() + static_cast<std::size_t>(accountColumn)];
+    }
+    int columnOf(const QString &account, Qt::CaseSensitivity cs = Qt::CaseSensitive) const;
+    std::vector<BillLine> monthLines(int monthRow) const;
+};
+
 class BillingEngine
 {
 public:
+    // 当前生效的套餐目录，默认为内置五档套餐
+    static const TariffCatalog &tariffs();
+    static void setTariffs(TariffCatalog catalog);
+
     static std::vector<BillLine> computeMonthly(
         int year, int month,
         const std::vector<User> &users,
         const std::vector<Session> &sessions);
 
+    // 与上面结果逐字节一致，但逐条会话只做整数裁剪，适合月末批量结算
+    static std::vector<BillLine> computeMonthly(
+        int year, int month,
+        const std::vector<User> &users,
+        const SessionColumns &sessions);
+
+    // 直接读取增量维护的用量汇总，耗时只与用户数相关
+    static std::vector<BillLine> computeMonthly(
+        int year, int month,
+        const std::vector<User> &users,
+        const AccountDirectory &accounts,
+        const UsageStore &usage);
+
+    // 将会话按自然月拆分，依次回调 (year, month, minutes)，分钟数口径与 computeMonthly 一致
+    static void splitByMonth(const QDateTime &begin, const QDateTime &end,
+                             const std::function<void(int, int, int)> &visit);
+
+    // 单次遍历会话，按月拆分后一次性得到 [fromMonth, toMonth] 内每月的账单，
+    // 每一行与对应月份的 computeMonthly 结果一致
+    static BillMatrix computeRange(
+        const QDate &fromMonth, const QDate &toMonth,
+        const std::vector<User> &users,
+        const std::vector<Session> &sessions);
+
+    // 按给定套餐目录重新计算每行费用（可用于试算调价），分钟数与套餐不变
+    static void priceLines(std::vector<BillLine> &lines, const TariffCatalog &catalog);
+
 private:
+    friend class MonthlyAccumulator;
+
     static int minutesInMonthPortion(const QDateTime &b, const QDateTime &e, int year, int month);
-    static double pricePerMinute() { return 0.03; }
-    static int includedMinutes(Tariff t);
-    static double baseFee(Tariff t);
-};
\ No newline at end of file
+    static int minutesInMonthPortion(qint64 b, qint64 e, qint64 monthBegin, qint64 monthLast);
+    static std::vector<BillLine> finalize(std::unordered_map<QString, BillLine> &map);
+};
+
+// 流式月度汇总：会话逐条送入，只保留每个用户的分钟数，内存与用户数相关、与会话数无关；
+// 送入同一组会话时 finish() 与 computeMonthly 结果一致。日志中删除的会话以 sign = -1 抵消
+class MonthlyAccumulator
+{
+public:
+    MonthlyAccumulator(int year, int month, const std::vector<User> &users);
+
+    // 账号对应的槽位，大小写不敏感；未注册账号返回 -1
+    int slotOf(const QString &account) const;
+    void add(int slot, qint64 beginSecs, qint64 endSecs, int sign = 1);
+    void add(const Session &session, int sign = 1);
+
+    std::vector<BillLine> finish() const;
+
+private:
+    qint64 m_monthBegin{0};
+    qint64 m_monthLast{0};
+    QHash<QString, int> m_slots;
+    std::vector<BillLine> m_lines;
+};
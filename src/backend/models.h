@@ -1,37 +1,28 @@
 #pragma once
 
+#include "backend/Money.h"
+
 #include <QDateTime>
 #include <QMetaType>
 #include <QString>
+#include <cstdint>
+#include <limits>
 #include <vector>
 
+// AccountDirectory 分配的稠密账号编号
+using AccountId = std::uint32_t;
+inline constexpr AccountId kInvalidAccountId = std::numeric_limits<AccountId>::max();
+
+// 套餐编号。此处仅列出内置套餐，具体计费参数与其余套餐由 TariffCatalog 提供
 enum class Tariff : int
 {
-    NoDiscount = 0, // 0.03 元/分钟
-    Pack30h = 1,    // 50 元包 30 小时，超出部分 0.03/分钟
-    Pack60h = 2,    // 95 元包 60 小时，超出部分 0.03/分钟
-    Pack150h = 3,   // 200 元包 150 小时，超出部分 0.03/分钟
-    Unlimited = 4   // 300 元不限时
+    NoDiscount = 0,
+    Pack30h = 1,
+    Pack60h = 2,
+    Pack150h = 3,
+    Unlimited = 4
 };
 
-inline QString tariffBillingDescription(Tariff plan)
-{
-    switch (plan)
-    {
-    case Tariff::NoDiscount:
-        return QStringLiteral(u"无优惠：按每分钟 0.03 元计费。");
-    case Tariff::Pack30h:
-        return QStringLiteral(u"每月 50 元含 30 小时，超出部分按每分钟 0.03 元计费。");
-    case Tariff::Pack60h:
-        return QStringLiteral(u"每月 95 元含 60 小时，超出部分按每分钟 0.03 元计费。");
-    case Tariff::Pack150h:
-        return QStringLiteral(u"每月 200 元含 150 小时，超出部分按每分钟 0.03 元计费。");
-    case Tariff::Unlimited:
-        return QStringLiteral(u"每月 300 元，上网时长不限。");
-    }
-    return QStringLiteral(u"套餐计费方式未知。");
-}
-
 enum class UserRole : int
 {
     Admin = 0,
@@ -46,7 +37,7 @@ struct User
     QString passwordHash;          // 登录密码哈希
     UserRole role{UserRole::User}; // 角色
     bool enabled{true};            // 是否启用
-    double balance{0.0};           // 当前余额
+    Money balance;                 // 当前余额
 };
 
 struct Session
@@ -54,6 +45,7 @@ struct Session
     QString account;
     QDateTime begin;
     QDateTime end;
+    AccountId accountId{kInvalidAccountId};
 };
 
 struct BillLine
@@ -62,17 +54,27 @@ struct BillLine
     QString name;
     int plan;
     int minutes;
-    double amount;
+    Money amount;
 };
 
 struct RechargeRecord
 {
     QString account;
     QDateTime timestamp;
-    double amount;
+    Money amount;
     QString operatorAccount;
     QString note;
-    double balanceAfter;
+    Money balanceAfter;
+    AccountId accountId{kInvalidAccountId};
+};
+
+// 批量充值文件中的一条记录
+struct RechargeRequest
+{
+    QString account;
+    Money amount;
+    QString note;
+    int record{0}; // 在文件中的记录序号（含表头），用于提示出错位置
 };
 
 Q_DECLARE_METATYPE(User)
@@ -1,11 +1,18 @@
 #include "Repository.h"
 
+#include "backend/Csv.h"
 #include "backend/Security.h"
+#include "backend/SessionFile.h"
+#include "backend/SessionJournal.h"
+#include "backend/Timestamp.h"
 
 #include <QDateTime>
+#include <QDebug>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QFileInfo>
+#include <QHash>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonParseError>
@@ -15,13 +22,24 @@
 #include <QStringConverter>
 #include <QStringList>
 #include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
 #include <QCryptographicHash>
+#include <QDataStream>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
 
 namespace
 {
     Tariff toTariff(int value)
     {
-        if (value < static_cast<int>(Tariff::NoDiscount) || value > static_cast<int>(Tariff::Unlimited))
+        // 套餐编号由 tariffs.csv 定义，未登记的编号在计费时按 0 号套餐处理
+        if (value < 0 || value >= TariffCatalog::kMaxPlans)
             return Tariff::NoDiscount;
         return static_cast<Tariff>(value);
     }
@@ -36,155 +54,735 @@ namespace
         return value.trimmed() == QLatin1String("1") || value.trimmed().compare(QStringLiteral("true"), Qt::CaseInsensitive) == 0;
     }
 
-    QDateTime parseCompact(const QString &s)
+    bool flagToBool(QByteArrayView value)
     {
-        // 例如 yyyyMMddHHmmss
-        return QDateTime::fromString(s, QStringLiteral("yyyyMMddHHmmss"));
+        value = Csv::trimmedAscii(value);
+        return value == QByteArrayView("1") || (value.size() == 4 && qstrnicmp(value.data(), "true", 4) == 0);
     }
 
-    QString formatCompact(const QDateTime &dt)
+    // 行首或行尾为非 ASCII 字符时可能带有全角空格等 Unicode 空白，
+    // 这类行交给按 QString 处理的通用路径
+    bool hasAsciiEdges(QByteArrayView line)
     {
-        return dt.toString(QStringLiteral("yyyyMMddHHmmss"));
+        return static_cast<unsigned char>(line.front()) < 0x80 && static_cast<unsigned char>(line.back()) < 0x80;
     }
 
-    QStringList parseCsvLine(const QString &line)
+    QStringList userChangeToRecord(const UserChange &change)
     {
-        QStringList fields;
-        QString current;
-        bool inQuotes = false;
-        for (int i = 0; i < line.size(); ++i)
+        const User &user = change.user;
+        switch (change.op)
+        {
+        case UserChange::Op::Balance:
+            return {QStringLiteral("B"), user.account, user.balance.toString()};
+        case UserChange::Op::Remove:
+            return {QStringLiteral("D"), user.account};
+        case UserChange::Op::Upsert:
+            break;
+        }
+        return {QStringLiteral("U"),
+                user.account,
+                user.name,
+                QString::number(static_cast<int>(user.plan)),
+                user.passwordHash,
+                QString::number(static_cast<int>(user.role)),
+                boolToFlag(user.enabled),
+                user.balance.toString()};
+    }
+
+    // 按日志顺序应用 users.ledger 中的记录，账号不存在的余额与删除记录直接忽略
+    void applyUserRecords(std::vector<User> &users, const std::vector<QStringList> &records)
+    {
+        QHash<QString, std::size_t> positions;
+        for (std::size_t i = 0; i < users.size(); ++i)
+            positions.insert(users[i].account, i);
+        std::vector<bool> removed(users.size(), false);
+
+        for (const QStringList &record : records)
         {
-            const QChar ch = line.at(i);
-            if (inQuotes)
+            const QString op = record.value(0);
+            const QString account = record.value(1);
+            const auto position = positions.constFind(account);
+            if (op == QLatin1String("B"))
             {
-                if (ch == QLatin1Char('"'))
+                if (position != positions.cend() && !removed[*position])
+                    users[*position].balance = Money::parse(record.value(2));
+            }
+            else if (op == QLatin1String("D"))
+            {
+                if (position != positions.cend())
+                    removed[*position] = true;
+            }
+            else if (op == QLatin1String("U") && record.size() >= 8 && !account.isEmpty())
+            {
+                User user;
+                user.account = account;
+                user.name = record.value(2);
+                user.plan = toTariff(record.value(3).toInt());
+                user.passwordHash = record.value(4);
+                user.role = static_cast<UserRole>(record.value(5).toInt());
+                user.enabled = flagToBool(record.value(6));
+                user.balance = Money::parse(record.value(7));
+                if (user.role != UserRole::Admin && user.role != UserRole::User)
+                    user.role = UserRole::User;
+
+                if (position != positions.cend())
                 {
-                    if (i + 1 < line.size() && line.at(i + 1) == QLatin1Char('"'))
-                    {
-                        current.append(QLatin1Char('"'));
-                        ++i;
-                    }
-                    else
-                    {
-                        inQuotes = false;
-                    }
+                    users[*position] = std::move(user);
+                    removed[*position] = false;
                 }
                 else
                 {
-                    current.append(ch);
+                    positions.insert(account, users.size());
+                    users.push_back(std::move(user));
+                    removed.push_back(false);
                 }
             }
+        }
+
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < users.size(); ++i)
+        {
+            if (removed[i])
+                continue;
+            if (kept != i)
+                users[kept] = std::move(users[i]);
+            ++kept;
+        }
+        users.resize(kept);
+    }
+
+    // 通用路径：含引号的 CSV 行或空白分隔的旧格式；返回 false 表示跳过该行
+    bool userFromText(const QString &line, User *user)
+    {
+        if (line.isEmpty() || line.startsWith(QLatin1Char('#')))
+            return false;
+
+        const QStringList csvParts = Csv::parseLine(line);
+        if (csvParts.size() >= 7)
+        {
+            if (csvParts.value(0).trimmed().compare(QStringLiteral("account"), Qt::CaseInsensitive) == 0)
+                return false;
+            user->account = csvParts.value(0).trimmed();
+            user->name = csvParts.value(1).trimmed();
+            user->plan = toTariff(csvParts.value(2).trimmed().toInt());
+            user->passwordHash = csvParts.value(3).trimmed();
+            user->role = static_cast<UserRole>(csvParts.value(4, QStringLiteral("1")).trimmed().toInt());
+            user->enabled = flagToBool(csvParts.value(5, QStringLiteral("1")));
+            user->balance = Money::parse(csvParts.value(6, QStringLiteral("0")));
+            return true;
+        }
+
+        const QStringList tokens = line.split(QRegularExpression(QStringLiteral("\\s+")), Qt::SkipEmptyParts);
+        if (tokens.size() >= 7)
+        {
+            user->account = tokens.value(0).trimmed();
+            if (user->account.compare(QStringLiteral("account"), Qt::CaseInsensitive) == 0)
+                return false;
+            user->name = tokens.value(1).trimmed();
+            user->plan = toTariff(tokens.value(2).toInt());
+            user->passwordHash = tokens.value(3).trimmed();
+            user->role = static_cast<UserRole>(tokens.value(4, QStringLiteral("1")).toInt());
+            user->enabled = flagToBool(tokens.value(5, QStringLiteral("1")));
+            user->balance = Money::parse(tokens.value(6, QStringLiteral("0")));
+            return true;
+        }
+
+        if (tokens.size() < 3)
+            return false;
+        user->name = tokens.value(0);
+        user->account = tokens.value(1);
+        user->plan = toTariff(tokens.value(2).toInt());
+        user->passwordHash = Security::hashPassword(QStringLiteral("123456"));
+        user->role = UserRole::User;
+        user->enabled = true;
+        user->balance = Money();
+        return true;
+    }
+
+    bool sessionFromText(const QString &line, Session *session)
+    {
+        if (line.isEmpty() || line.startsWith(QLatin1Char('#')))
+            return false;
+
+        const QStringList fields = Csv::parseLine(line);
+        QString account;
+        QString beginStr;
+        QString endStr;
+        if (fields.size() >= 3)
+        {
+            account = fields.value(0).trimmed();
+            beginStr = fields.value(1).trimmed();
+            endStr = fields.value(2).trimmed();
+            if (account.compare(QStringLiteral("account"), Qt::CaseInsensitive) == 0)
+                return false;
+        }
+        else
+        {
+            const QStringList tokens = line.split(QRegularExpression(QStringLiteral("\\s+")), Qt::SkipEmptyParts);
+            if (tokens.size() < 3)
+                return false;
+            account = tokens.value(0).trimmed();
+            if (account.compare(QStringLiteral("account"), Qt::CaseInsensitive) == 0)
+                return false;
+            beginStr = tokens.value(1).trimmed();
+            endStr = tokens.value(2).trimmed();
+        }
+
+        if (account.isEmpty())
+            return false;
+        *session = Session{account, Timestamp::fromCompact(beginStr), Timestamp::fromCompact(endStr)};
+        return true;
+    }
+
+    // sessions.csv 的一条记录：不含引号的 ASCII 行直接按字节切分，其余交给通用路径
+    bool sessionFromRecord(QByteArrayView line, Session *session)
+    {
+        QByteArrayView fields[3];
+        if (hasAsciiEdges(line) && Csv::splitUnquoted(line, fields, 3) >= 3)
+        {
+            QString account = Csv::fieldToString(fields[0]);
+            if (account.isEmpty() || account.compare(QStringLiteral("account"), Qt::CaseInsensitive) == 0)
+                return false;
+            *session = Session{std::move(account), Timestamp::fromCompact(Csv::trimmedAscii(fields[1])), Timestamp::fromCompact(Csv::trimmedAscii(fields[2]))};
+            return true;
+        }
+        return sessionFromText(QString::fromUtf8(line.data(), line.size()).trimmed(), session);
+    }
+
+    // 超过 Csv::kParallelParseThreshold 时分段并行解析，结果与单线程一致
+    std::vector<Session> sessionsFromCsv(const QString &path)
+    {
+        Csv::MappedFile file(path);
+        if (!file.isOpen())
+            return {};
+
+        const auto parseChunk = [](QByteArrayView chunk, std::vector<Session> &sessions)
+        {
+            Csv::forEachRecord(chunk, [&](QByteArrayView line)
+                               {
+                Session session;
+                if (sessionFromRecord(line, &session))
+                    sessions.push_back(std::move(session)); });
+        };
+        return Csv::parseChunked<Session>(file.data(), parseChunk);
+    }
+
+    QDate monthOf(const QDateTime &dateTime)
+    {
+        const QDate date = dateTime.date();
+        return QDate(date.year(), date.month(), 1);
+    }
+
+    // 会话与 [fromMonth, toMonth] 有交集：开始月份在范围内，或更早开始、延续到范围内
+    bool overlapsMonths(const Session &session, const QDate &fromMonth, const QDate &toMonth)
+    {
+        if (!session.begin.isValid())
+            return false;
+        const QDate beginMonth = monthOf(session.begin);
+        if (beginMonth > toMonth)
+            return false;
+        return beginMonth >= fromMonth || (session.end.isValid() && monthOf(session.end) >= fromMonth);
+    }
+
+    // 开始月份之后还有时长的会话记入溢出索引
+    bool spillsOver(const Session &session)
+    {
+        return session.begin.isValid() && session.end.isValid() && monthOf(session.end) > monthOf(session.begin);
+    }
+
+    void writeSessionHeader(Csv::Writer &out)
+    {
+        out.field(u"account").field(u"begin").field(u"end").endRow();
+    }
+
+    void writeSessionRow(Csv::Writer &out, const Session &session)
+    {
+        out.field(session.account).compactTime(session.begin).compactTime(session.end).endRow();
+    }
+
+    void writeRechargeHeader(Csv::Writer &out)
+    {
+        out.field(u"account").field(u"timestamp").field(u"amount").field(u"operator").field(u"note").field(u"balance_after").endRow();
+    }
+
+    void writeRechargeRow(Csv::Writer &out, const RechargeRecord &record)
+    {
+        out.field(record.account)
+            .isoTime(record.timestamp)
+            .fixed(record.amount.cents(), 2)
+            .field(record.operatorAccount)
+            .field(record.note)
+            .fixed(record.balanceAfter.cents(), 2)
+            .endRow();
+    }
+
+    bool writeSessionRows(const QString &path, const std::vector<const Session *> &rows)
+    {
+        if (rows.empty())
+            return !QFileInfo::exists(path) || QFile::remove(path);
+
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+            return false;
+        Csv::Writer out(&file);
+        writeSessionHeader(out);
+        for (const Session *session : rows)
+            writeSessionRow(out, *session);
+        return out.finish() && file.commit();
+    }
+
+    // 一条充值流水：CSV 行或空白分隔的旧格式；返回 false 表示跳过该行
+    bool rechargeFromText(const QString &line, RechargeRecord *record)
+    {
+        if (line.isEmpty())
+            return false;
+        const QStringList parts = Csv::parseLine(line);
+        if (parts.size() >= 6)
+        {
+            if (parts.value(0).trimmed().compare(QStringLiteral("account"), Qt::CaseInsensitive) == 0)
+                return false;
+            record->account = parts.value(0).trimmed();
+            record->timestamp = Timestamp::fromIso(parts.value(1).trimmed());
+            record->amount = Money::parse(parts.value(2));
+            record->operatorAccount = parts.value(3).trimmed();
+            record->note = parts.value(4).trimmed();
+            record->balanceAfter = Money::parse(parts.value(5));
+        }
+        else
+        {
+            QStringList tokens = line.split(QRegularExpression(QStringLiteral("\\s+")), Qt::SkipEmptyParts);
+            if (tokens.size() < 5)
+                return false;
+
+            const QString balanceToken = tokens.takeLast();
+            record->balanceAfter = Money::parse(balanceToken);
+
+            if (tokens.size() < 4)
+                return false;
+
+            record->account = tokens.value(0).trimmed();
+            if (record->account.compare(QStringLiteral("account"), Qt::CaseInsensitive) == 0)
+                return false;
+            record->timestamp = Timestamp::fromIso(tokens.value(1).trimmed());
+            record->amount = Money::parse(tokens.value(2));
+            record->operatorAccount = tokens.value(3).trimmed();
+            if (tokens.size() > 4)
+                record->note = tokens.mid(4).join(QStringLiteral(" ")).trimmed();
             else
+                record->note.clear();
+        }
+
+        if (!record->timestamp.isValid())
+            record->timestamp = QDateTime::currentDateTime();
+        return true;
+    }
+
+    // 备份归档以 "NBBACKUP"、版本号与创建时间开头。
+    // 版本 2：每个文件一项：相对路径、大小、若干 [长度 + 数据] 块（以长度 0 结束）与内容的 SHA-256，
+    // 最后记录文件数。读写时内存中只保留一个块，哈希随块增量计算
+    const QByteArray kArchiveMagic("NBBACKUP");
+    constexpr quint32 kStreamArchiveVersion = 2;
+    constexpr qsizetype kArchiveChunkBytes = 1024 * 1024;
+    constexpr quint8 kArchiveFileTag = 'F';
+    constexpr quint8 kArchiveEndTag = 'E';
+
+    // 版本 3：文件头之后是各数据块的原始内容，随后是 JSON 清单与定长尾部（清单偏移、清单长度、
+    // "NBMANIFT"）。清单为每个文件记录大小、修改时间、SHA-256 及各块的 SHA-256、长度、所在归档与偏移。
+    // 增量备份只写入与基准清单不同的块，其余块直接引用基准链中的位置，恢复时不需要逐级回放；
+    // 同一条链上的归档须放在同一目录中。
+    // 压缩模式下块以 qCompress（zlib）格式单独压缩，清单另记 "stored" 为归档中的字节数；
+    // 压缩后不更小的块仍按原样存放。哈希始终针对原始内容，压缩与否的备份可以互为基准
+    constexpr quint32 kManifestArchiveVersion = 3;
+    const QByteArray kManifestMagic("NBMANIFT");
+    constexpr qint64 kManifestFooterBytes = 8 + 8 + 8;
+
+    QString hexDigest(QByteArrayView data)
+    {
+        return QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Sha256).toHex());
+    }
+
+    bool readManifest(const QString &archivePath, QJsonObject *manifest, QString *error)
+    {
+        const auto fail = [&](const QString &msg) {
+            if (error)
+                *error = msg;
+            return false;
+        };
+
+        QFile file(archivePath);
+        if (!file.open(QIODevice::ReadOnly))
+            return fail(QStringLiteral(u"无法打开备份文件：%1").arg(QDir::toNativeSeparators(archivePath)));
+
+        QDataStream stream(&file);
+        stream.setVersion(QDataStream::Qt_6_0);
+        QByteArray magic(kArchiveMagic.size(), Qt::Uninitialized);
+        quint32 version = 0;
+        stream.readRawData(magic.data(), static_cast<int>(magic.size()));
+        stream >> version;
+        if (stream.status() != QDataStream::Ok || magic != kArchiveMagic || version != kManifestArchiveVersion)
+            return fail(QStringLiteral(u"不是可用作基准的备份文件：%1").arg(QDir::toNativeSeparators(archivePath)));
+
+        qint64 offset = 0;
+        qint64 length = 0;
+        QByteArray footer(kManifestMagic.size(), Qt::Uninitialized);
+        if (file.size() < kManifestFooterBytes || !file.seek(file.size() - kManifestFooterBytes))
+            return fail(QStringLiteral(u"备份文件不完整。"));
+        stream >> offset >> length;
+        stream.readRawData(footer.data(), static_cast<int>(footer.size()));
+        if (stream.status() != QDataStream::Ok || footer != kManifestMagic || offset < 0 || length < 0
+            || offset + length > file.size() - kManifestFooterBytes || !file.seek(offset))
+            return fail(QStringLiteral(u"备份文件不完整。"));
+
+        QJsonParseError parseError{};
+        const auto document = QJsonDocument::fromJson(file.read(length), &parseError);
+        if (parseError.error != QJsonParseError::NoError || !document.isObject())
+            return fail(QStringLiteral(u"备份清单格式错误：%1").arg(parseError.errorString()));
+        *manifest = document.object();
+        return true;
+    }
+
+    // 清单中块所在归档的文件名，空表示清单所在的归档本身
+    QString blockArchive(const QJsonObject &block, const QString &self)
+    {
+        const QString archive = block.value(QStringLiteral("archive")).toString();
+        return archive.isEmpty() ? self : archive;
+    }
+
+    // 备份中的相对路径不得指向数据目录之外
+    bool restorePath(const QDir &dir, const QString &name, QString *path)
+    {
+        const QString cleaned = QDir::cleanPath(name);
+        if (QDir::isAbsolutePath(cleaned) || cleaned == QLatin1String("..") || cleaned.startsWith(QLatin1String("../")))
+            return false;
+        *path = dir.filePath(cleaned);
+        return true;
+    }
+
+    // 在线程池中并行执行任务，任一任务失败后尚未开始的任务直接跳过；返回第一条错误
+    bool runParallel(const std::vector<std::function<bool(QString *)>> &tasks, QString *error)
+    {
+        std::mutex mutex;
+        std::atomic<bool> failed{false};
+        QString firstError;
+        QThreadPool pool;
+        pool.setMaxThreadCount(QThread::idealThreadCount());
+        for (const auto &task : tasks)
+        {
+            pool.start([&]()
+                       {
+                if (failed.load())
+                    return;
+                QString taskError;
+                if (task(&taskError))
+                    return;
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!failed.exchange(true))
+                    firstError = taskError; });
+        }
+        pool.waitForDone();
+        if (failed.load() && error)
+            *error = firstError;
+        return !failed.load();
+    }
+
+    // 目标路径的上级目录由调用方预先创建，任务中只写文件
+    bool prepareTarget(const QDir &dir, const QString &name, QString *targetPath, QString *error)
+    {
+        if (name.isEmpty())
+        {
+            *error = QStringLiteral(u"备份文件包含空文件名。");
+            return false;
+        }
+        if (!restorePath(dir, name, targetPath))
+        {
+            *error = QStringLiteral(u"备份文件包含无效路径：%1").arg(name);
+            return false;
+        }
+        const QString parent = QFileInfo(*targetPath).path();
+        if (!QDir().mkpath(parent))
+        {
+            *error = QStringLiteral(u"无法创建目标目录：%1").arg(parent);
+            return false;
+        }
+        return true;
+    }
+
+    // 版本 1：每个文件为 JSON 对象，内容以 base64 存放；各文件的解码、校验与写入并行进行
+    bool restoreJsonFiles(const QJsonArray &files, const QDir &dir, QString *error)
+    {
+        std::vector<std::function<bool(QString *)>> tasks;
+        for (const QJsonValue &value : files)
+        {
+            if (!value.isObject())
+            {
+                if (error)
+                    *error = QStringLiteral(u"备份文件包含无效条目。");
+                return false;
+            }
+
+            const QJsonObject fileObject = value.toObject();
+            const QString name = fileObject.value(QStringLiteral("name")).toString();
+            QString targetPath;
+            QString prepareError;
+            if (!prepareTarget(dir, name, &targetPath, &prepareError))
             {
-                if (ch == QLatin1Char('"'))
+                if (error)
+                    *error = prepareError;
+                return false;
+            }
+
+            tasks.push_back([fileObject, name, targetPath](QString *taskError)
+                            {
+                const QString encoded = fileObject.value(QStringLiteral("data")).toString();
+                const QByteArray data = QByteArray::fromBase64(encoded.toLatin1());
+                if (!encoded.isEmpty() && data.isEmpty() && fileObject.value(QStringLiteral("size")).toInt() > 0)
                 {
-                    inQuotes = true;
+                    *taskError = QStringLiteral(u"备份内容损坏：%1").arg(name);
+                    return false;
                 }
-                else if (ch == QLatin1Char(','))
+
+                const QByteArray expected = QByteArray::fromHex(fileObject.value(QStringLiteral("sha256")).toString().toLatin1());
+                if (!expected.isEmpty() && QCryptographicHash::hash(data, QCryptographicHash::Sha256) != expected)
                 {
-                    fields.append(current);
-                    current.clear();
+                    *taskError = QStringLiteral(u"备份校验失败：%1").arg(name);
+                    return false;
                 }
-                else
+
+                QFile out(targetPath);
+                if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate) || out.write(data) != data.size())
                 {
-                    current.append(ch);
+                    *taskError = QStringLiteral(u"写入文件失败：%1").arg(name);
+                    return false;
                 }
-            }
+                return true; });
         }
-        fields.append(current);
-        return fields;
+        return runParallel(tasks, error);
     }
 
-    QString encodeCsvField(const QString &field)
+    bool restoreArchive(QDataStream &in, const QDir &dir, QString *error)
     {
-        QString result = field;
-        bool needsQuotes = result.contains(QLatin1Char(',')) || result.contains(QLatin1Char('\n')) || result.contains(QLatin1Char('\r'));
-        if (result.contains(QLatin1Char('"')))
+        const auto setError = [&](const QString &msg) {
+            if (error)
+                *error = msg;
+        };
+        const auto truncated = [&]() {
+            setError(QStringLiteral(u"备份文件不完整。"));
+            return false;
+        };
+
+        QByteArray buffer;
+        quint32 fileCount = 0;
+        while (true)
         {
-            result.replace(QLatin1Char('"'), QString(2, QLatin1Char('"')));
-            needsQuotes = true;
+            quint8 tag = 0;
+            in >> tag;
+            if (in.status() != QDataStream::Ok)
+                return truncated();
+            if (tag == kArchiveEndTag)
+            {
+                quint32 expectedCount = 0;
+                in >> expectedCount;
+                if (in.status() != QDataStream::Ok || expectedCount != fileCount)
+                    return truncated();
+                return true;
+            }
+            if (tag != kArchiveFileTag)
+            {
+                setError(QStringLiteral(u"备份文件包含无效条目。"));
+                return false;
+            }
+
+            QString name;
+            qint64 size = 0;
+            in >> name >> size;
+            if (in.status() != QDataStream::Ok)
+                return truncated();
+            if (name.isEmpty())
+            {
+                setError(QStringLiteral(u"备份文件包含空文件名。"));
+                return false;
+            }
+            QString targetPath;
+            if (!restorePath(dir, name, &targetPath))
+            {
+                setError(QStringLiteral(u"备份文件包含无效路径：%1").arg(name));
+                return false;
+            }
+            const QFileInfo targetInfo(targetPath);
+            if (!QDir().mkpath(targetInfo.path()))
+            {
+                setError(QStringLiteral(u"无法创建目标目录：%1").arg(targetInfo.path()));
+                return false;
+            }
+
+            // 边读边写入临时文件，校验通过后才提交
+            QSaveFile out(targetInfo.absoluteFilePath());
+            if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            {
+                setError(QStringLiteral(u"无法恢复文件：%1").arg(name));
+                return false;
+            }
+            QCryptographicHash hash(QCryptographicHash::Sha256);
+            qint64 written = 0;
+            while (true)
+            {
+                quint32 length = 0;
+                in >> length;
+                if (in.status() != QDataStream::Ok)
+                    return truncated();
+                if (length == 0)
+                    break;
+                if (length > static_cast<quint32>(kArchiveChunkBytes))
+                {
+                    setError(QStringLiteral(u"备份内容损坏：%1").arg(name));
+                    return false;
+                }
+                buffer.resize(length);
+                if (in.readRawData(buffer.data(), static_cast<int>(length)) != static_cast<int>(length))
+                    return truncated();
+                hash.addData(buffer);
+                if (out.write(buffer) != buffer.size())
+                {
+                    setError(QStringLiteral(u"写入文件失败：%1").arg(name));
+                    return false;
+                }
+                written += length;
+            }
+
+            QByteArray expected(32, Qt::Uninitialized);
+            if (in.readRawData(expected.data(), static_cast<int>(expected.size())) != expected.size())
+                return truncated();
+            if (written != size || hash.result() != expected)
+            {
+                out.cancelWriting();
+                setError(QStringLiteral(u"备份校验失败：%1").arg(name));
+                return false;
+            }
+            if (!out.commit())
+            {
+                setError(QStringLiteral(u"提交文件失败：%1").arg(name));
+                return false;
+            }
+            ++fileCount;
         }
-        if (needsQuotes)
-            return QStringLiteral("\"%1\"").arg(result);
-        return result;
     }
 
-    void writeCsvRow(QTextStream &out, const QStringList &fields)
+    // 版本 3：先按清单建好目标文件并预留大小，再以块为单位并行读取、解压、校验并写入各自的偏移处。
+    // 每个块都按清单中的哈希校验且各块长度之和等于文件大小，不再另算整个文件的哈希
+    bool restoreManifest(const QString &archivePath, const QJsonObject &manifest, const QDir &dir, QString *error)
     {
-        QStringList encoded;
-        encoded.reserve(fields.size());
-        for (const auto &field : fields)
-            encoded.append(encodeCsvField(field));
-        out << encoded.join(QLatin1Char(',')) << QLatin1Char('\n');
+        const auto fail = [&](const QString &msg) {
+            if (error)
+                *error = msg;
+            return false;
+        };
+
+        const QFileInfo archiveInfo(archivePath);
+        std::vector<std::function<bool(QString *)>> tasks;
+        for (const QJsonValue &value : manifest.value(QStringLiteral("files")).toArray())
+        {
+            const QJsonObject fileObject = value.toObject();
+            const QString name = fileObject.value(QStringLiteral("name")).toString();
+            QString targetPath;
+            QString prepareError;
+            if (!prepareTarget(dir, name, &targetPath, &prepareError))
+                return fail(prepareError);
+
+            const qint64 size = fileObject.value(QStringLiteral("size")).toInteger(-1);
+            qint64 targetOffset = 0;
+            for (const QJsonValue &blockValue : fileObject.value(QStringLiteral("blocks")).toArray())
+            {
+                const QJsonObject block = blockValue.toObject();
+                const QString archive = blockArchive(block, archiveInfo.fileName());
+                const qint64 offset = block.value(QStringLiteral("offset")).toInteger(-1);
+                const qint64 length = block.value(QStringLiteral("length")).toInteger(-1);
+                const qint64 stored = block.value(QStringLiteral("stored")).toInteger(length);
+                if (QFileInfo(archive).fileName() != archive)
+                    return fail(QStringLiteral(u"缺少基准备份：%1").arg(archive));
+                if (offset < 0 || length < 0 || length > kArchiveChunkBytes || stored < 0 || stored > 2 * kArchiveChunkBytes)
+                    return fail(QStringLiteral(u"备份内容损坏：%1").arg(name));
+
+                tasks.push_back([=, sourcePath = archiveInfo.absoluteDir().filePath(archive)](QString *taskError)
+                                {
+                    QFile source(sourcePath);
+                    QByteArray buffer(stored, Qt::Uninitialized);
+                    if (!source.open(QIODevice::ReadOnly) || !source.seek(offset) || source.read(buffer.data(), stored) != stored)
+                    {
+                        *taskError = QStringLiteral(u"备份文件不完整：%1").arg(archive);
+                        return false;
+                    }
+                    if (block.value(QStringLiteral("compressed")).toBool())
+                        buffer = qUncompress(buffer);
+                    if (buffer.size() != length || hexDigest(buffer) != block.value(QStringLiteral("sha256")).toString())
+                    {
+                        *taskError = QStringLiteral(u"备份校验失败：%1").arg(name);
+                        return false;
+                    }
+
+                    QFile out(targetPath);
+                    if (!out.open(QIODevice::ReadWrite) || !out.seek(targetOffset) || out.write(buffer) != buffer.size())
+                    {
+                        *taskError = QStringLiteral(u"写入文件失败：%1").arg(name);
+                        return false;
+                    }
+                    return true; });
+                targetOffset += length;
+            }
+
+            QFile out(targetPath);
+            if (targetOffset != size)
+                return fail(QStringLiteral(u"备份校验失败：%1").arg(name));
+            if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate) || !out.resize(size))
+                return fail(QStringLiteral(u"无法恢复文件：%1").arg(name));
+        }
+        return runParallel(tasks, error);
     }
 } // namespace
 
 Repository::Repository(QString dataDir, QString outDir)
     : m_dataDir(std::move(dataDir)), m_outDir(std::move(outDir))
 {
+    m_userLedger = std::make_shared<WriteAheadLog>(usersLedgerPath(), usersPath(), QByteArrayLiteral("ledger-seq"));
+    recoverInterruptedRestore();
 }
 
 std::vector<User> Repository::loadUsers() const
 {
     std::vector<User> users;
-    QFile file(usersPath());
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
-        return users;
-
-    QTextStream in(&file);
-    in.setEncoding(QStringConverter::Utf8);
-    QString line;
-    while (in.readLineInto(&line))
     {
-        line = line.trimmed();
-        if (line.isEmpty() || line.startsWith(QLatin1Char('#')))
-            continue;
+        Csv::MappedFile file(usersPath());
+        if (file.isOpen())
+            parseUsers(file.data(), users);
+    }
+    applyUserRecords(users, m_userLedger->read());
+    return users;
+}
 
+void Repository::parseUsers(QByteArrayView data, std::vector<User> &users)
+{
+    Csv::forEachLine(data, [&](QByteArrayView line)
+                     {
         User user;
-        const QStringList csvParts = parseCsvLine(line);
-        if (csvParts.size() >= 7)
+        QByteArrayView fields[7];
+        if (hasAsciiEdges(line) && Csv::splitUnquoted(line, fields, 7) >= 7)
         {
-            if (csvParts.value(0).trimmed().compare(QStringLiteral("account"), Qt::CaseInsensitive) == 0)
-                continue;
-            user.account = csvParts.value(0).trimmed();
-            user.name = csvParts.value(1).trimmed();
-            user.plan = toTariff(csvParts.value(2).trimmed().toInt());
-            user.passwordHash = csvParts.value(3).trimmed();
-            user.role = static_cast<UserRole>(csvParts.value(4, QStringLiteral("1")).trimmed().toInt());
-            user.enabled = flagToBool(csvParts.value(5, QStringLiteral("1")));
-            user.balance = csvParts.value(6, QStringLiteral("0")).trimmed().toDouble();
+            user.account = Csv::fieldToString(fields[0]);
+            if (user.account.compare(QStringLiteral("account"), Qt::CaseInsensitive) == 0)
+                return;
+            user.name = Csv::fieldToString(fields[1]);
+            user.plan = toTariff(Csv::fieldToInt(fields[2]));
+            user.passwordHash = Csv::fieldToString(fields[3]);
+            user.role = static_cast<UserRole>(Csv::fieldToInt(fields[4]));
+            user.enabled = flagToBool(fields[5]);
+            user.balance = Money::parse(Csv::fieldToString(fields[6]));
         }
-        else
+        else if (!userFromText(QString::fromUtf8(line.data(), line.size()).trimmed(), &user))
         {
-            const QStringList tokens = line.split(QRegularExpression(QStringLiteral("\\s+")), Qt::SkipEmptyParts);
-            if (tokens.size() >= 7)
-            {
-                user.account = tokens.value(0).trimmed();
-                if (user.account.compare(QStringLiteral("account"), Qt::CaseInsensitive) == 0)
-                    continue;
-                user.name = tokens.value(1).trimmed();
-                user.plan = toTariff(tokens.value(2).toInt());
-                user.passwordHash = tokens.value(3).trimmed();
-                user.role = static_cast<UserRole>(tokens.value(4, QStringLiteral("1")).toInt());
-                user.enabled = flagToBool(tokens.value(5, QStringLiteral("1")));
-                user.balance = tokens.value(6, QStringLiteral("0")).toDouble();
-            }
-            else
-            {
-                if (tokens.size() < 3)
-                    continue;
-                user.name = tokens.value(0);
-                user.account = tokens.value(1);
-                user.plan = toTariff(tokens.value(2).toInt());
-                user.passwordHash = Security::hashPassword(QStringLiteral("123456"));
-                user.role = UserRole::User;
-                user.enabled = true;
-                user.balance = 0.0;
-            }
+            return;
         }
 
         if (user.account.isEmpty())
-            continue;
+            return;
 
         if (user.passwordHash.isEmpty())
             user.passwordHash = Security::hashPassword(QStringLiteral("123456"));
@@ -192,109 +790,464 @@ std::vector<User> Repository::loadUsers() const
         if (user.role != UserRole::Admin && user.role != UserRole::User)
             user.role = UserRole::User;
 
-        users.push_back(std::move(user));
-    }
-    return users;
+        users.push_back(std::move(user)); });
 }
 
 std::vector<Session> Repository::loadSessions() const
 {
     std::vector<Session> sessions;
-    QFile file(sessionsPath());
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
-        return sessions;
-
-    QTextStream in(&file);
-    in.setEncoding(QStringConverter::Utf8);
-    QString line;
-    while (in.readLineInto(&line))
+    if (sessionsPartitioned())
     {
-        line = line.trimmed();
-        if (line.isEmpty() || line.startsWith(QLatin1Char('#')))
-            continue;
-        const QStringList fields = parseCsvLine(line);
-        QString account;
-        QString beginStr;
-        QString endStr;
-        if (fields.size() >= 3)
+        for (const QDate &month : sessionPartitionMonths())
         {
-            account = fields.value(0).trimmed();
-            beginStr = fields.value(1).trimmed();
-            endStr = fields.value(2).trimmed();
-            if (account.compare(QStringLiteral("account"), Qt::CaseInsensitive) == 0)
-                continue;
+            std::vector<Session> part = sessionsFromCsv(sessionsPartitionPath(month));
+            sessions.insert(sessions.end(), std::make_move_iterator(part.begin()), std::make_move_iterator(part.end()));
         }
-        else
+        return sessions;
+    }
+    return loadFlatSessions();
+}
+
+std::vector<Session> Repository::loadFlatSessions() const
+{
+    // 后台压缩可能在读基础文件与读日志之间提交，此时旧的基础内容会配上新的序号，
+    // 待压缩文件中的变更随之丢失；读完后序号变了就整体重读
+    while (true)
+    {
+        const qint64 baseSequence = SessionJournal::baseSequence(sessionsPath());
+        std::vector<Session> sessions;
         {
-            const QStringList tokens = line.split(QRegularExpression(QStringLiteral("\\s+")), Qt::SkipEmptyParts);
-            if (tokens.size() < 3)
-                continue;
-            account = tokens.value(0).trimmed();
-            if (account.compare(QStringLiteral("account"), Qt::CaseInsensitive) == 0)
-                continue;
-            beginStr = tokens.value(1).trimmed();
-            endStr = tokens.value(2).trimmed();
+            SessionFile snapshot;
+            if (snapshot.open(sessionsBinaryPath()) && snapshot.matchesSource(QFileInfo(sessionsPath())))
+                sessions = snapshot.toSessions();
+            else
+                sessions = sessionsFromCsv(sessionsPath());
         }
 
-        if (account.isEmpty())
+        std::vector<SessionChange> changes;
+        SessionJournal::read(sessionsCompactingPath(), baseSequence, &changes);
+        SessionJournal::read(sessionsJournalPath(), baseSequence, &changes);
+        if (SessionJournal::baseSequence(sessionsPath()) != baseSequence)
             continue;
-        sessions.push_back(Session{account, parseCompact(beginStr), parseCompact(endStr)});
+        SessionJournal::apply(sessions, changes);
+        return sessions;
+    }
+}
+
+std::vector<Session> Repository::loadSessions(const QDate &fromMonth, const QDate &toMonth) const
+{
+    const QDate from(fromMonth.year(), fromMonth.month(), 1);
+    const QDate to = toMonth.isValid() ? QDate(toMonth.year(), toMonth.month(), 1) : QDate(9999, 12, 1);
+    std::vector<Session> sessions;
+    if (!sessionsPartitioned())
+    {
+        sessions = loadFlatSessions();
+        sessions.erase(std::remove_if(sessions.begin(), sessions.end(), [&](const Session &session)
+                                      { return !overlapsMonths(session, from, to); }),
+                       sessions.end());
+        return sessions;
+    }
+
+    for (const QDate &month : sessionPartitionMonths())
+    {
+        if (month < from || (toMonth.isValid() && month > to))
+            continue;
+        std::vector<Session> part = sessionsFromCsv(sessionsPartitionPath(month));
+        sessions.insert(sessions.end(), std::make_move_iterator(part.begin()), std::make_move_iterator(part.end()));
+    }
+    // 范围内开始的跨月会话已在分区中，只补充更早开始的
+    for (Session &session : sessionsFromCsv(sessionsSpillPath()))
+    {
+        if (monthOf(session.begin) < from && overlapsMonths(session, from, to))
+            sessions.push_back(std::move(session));
     }
     return sessions;
 }
 
+SessionColumns Repository::loadSessionColumns() const
+{
+    if (sessionsPartitioned())
+        return SessionColumns::fromSessions(loadSessions());
+
+    // 有未压缩的日志时快照不完整
+    if (QFileInfo(sessionsJournalPath()).size() > 0 || QFileInfo::exists(sessionsCompactingPath()))
+        return SessionColumns::fromSessions(loadSessions());
+
+    SessionFile snapshot;
+    if (snapshot.open(sessionsBinaryPath()) && snapshot.matchesSource(QFileInfo(sessionsPath())))
+        return snapshot.toColumns();
+    return SessionColumns::fromSessions(loadSessions());
+}
+
 bool Repository::saveUsers(const std::vector<User> &users) const
 {
     QDir().mkpath(m_dataDir);
-    QFile file(usersPath());
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+    return m_userLedger->checkpoint([&](qint64 sequence)
+                                    {
+        QSaveFile file(usersPath());
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+            return false;
+
+        Csv::Writer out(&file);
+        out.rawLine(m_userLedger->baseHeaderLine(sequence).toUtf8());
+        out.field(u"account").field(u"name").field(u"plan").field(u"password_hash").field(u"role").field(u"enabled").field(u"balance").endRow();
+        for (const auto &user : users)
+        {
+            out.field(user.account)
+                .field(user.name)
+                .field(static_cast<qint64>(user.plan))
+                .field(user.passwordHash)
+                .field(static_cast<qint64>(user.role))
+                .field(user.enabled ? 1 : 0)
+                .fixed(user.balance.cents(), 2)
+                .endRow();
+        }
+        return out.finish() && file.commit(); });
+}
+
+bool Repository::commitUserChanges(const std::vector<UserChange> &changes, QString *error) const
+{
+    std::vector<QStringList> records;
+    records.reserve(changes.size());
+    for (const auto &change : changes)
+        records.push_back(userChangeToRecord(change));
+    return m_userLedger->append(records, error);
+}
+
+bool Repository::userLedgerNeedsCheckpoint() const
+{
+    const qint64 ledgerSize = m_userLedger->size();
+    return ledgerSize >= 64 * 1024 && ledgerSize * 2 >= QFileInfo(usersPath()).size();
+}
+
+bool Repository::saveSessions(const std::vector<Session> &sessions) const
+{
+    if (sessionsPartitioned())
+    {
+        // 已不含任何会话的月份也要重写（即删除）其分区
+        std::vector<QDate> months = sessionPartitionMonths();
+        for (const auto &session : sessions)
+        {
+            if (session.begin.isValid())
+                months.push_back(monthOf(session.begin));
+        }
+        std::sort(months.begin(), months.end());
+        months.erase(std::unique(months.begin(), months.end()), months.end());
+        return saveSessionPartitions(sessions, months);
+    }
+
+    QDir().mkpath(m_dataDir);
+    if (!writeSessionsBase(sessions, lastSessionSequence()))
         return false;
+    QFile::remove(sessionsCompactingPath());
+    QFile::remove(sessionsJournalPath());
+    return true;
+}
 
-    QTextStream out(&file);
-    out.setEncoding(QStringConverter::Utf8);
-    writeCsvRow(out,
-                {QStringLiteral("account"),
-                 QStringLiteral("name"),
-                 QStringLiteral("plan"),
-                 QStringLiteral("password_hash"),
-                 QStringLiteral("role"),
-                 QStringLiteral("enabled"),
-                 QStringLiteral("balance")});
-    for (const auto &user : users)
-    {
-        writeCsvRow(out,
-                    {user.account,
-                     user.name,
-                     QString::number(static_cast<int>(user.plan)),
-                     user.passwordHash,
-                     QString::number(static_cast<int>(user.role)),
-                     boolToFlag(user.enabled),
-                     QString::number(user.balance, 'f', 2)});
+bool Repository::writeSessionsBase(const std::vector<Session> &sessions, qint64 sequence) const
+{
+    {
+        QSaveFile file(sessionsPath());
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+            return false;
+
+        Csv::Writer out(&file);
+        out.rawLine(SessionJournal::baseHeaderLine(sequence).toUtf8());
+        writeSessionHeader(out);
+        for (const auto &session : sessions)
+            writeSessionRow(out, session);
+        if (!out.finish() || !file.commit())
+            return false;
+    }
+
+    // CSV 提交后再写快照，快照头部记录的是 CSV 的最终大小与修改时间；
+    // 快照写失败不影响保存结果，删除旧快照以免下次加载到过期数据
+    QString error;
+    if (!SessionFile::write(sessionsBinaryPath(), sessions, QFileInfo(sessionsPath()), &error))
+    {
+        qWarning() << error;
+        QFile::remove(sessionsBinaryPath());
     }
     return true;
 }
 
-bool Repository::saveSessions(const std::vector<Session> &sessions) const
+qint64 Repository::lastSessionSequence() const
+{
+    return std::max({SessionJournal::baseSequence(sessionsPath()),
+                     SessionJournal::lastSequence(sessionsCompactingPath()),
+                     SessionJournal::lastSequence(sessionsJournalPath())});
+}
+
+bool Repository::appendSessionChanges(const std::vector<SessionChange> &changes, QString *error) const
+{
+    if (changes.empty())
+        return true;
+    QDir().mkpath(m_dataDir);
+    return SessionJournal::append(sessionsJournalPath(), changes, lastSessionSequence() + 1, error);
+}
+
+bool Repository::sessionJournalNeedsCompaction() const
+{
+    if (QFileInfo::exists(sessionsCompactingPath()))
+        return true;
+    const qint64 journalSize = QFileInfo(sessionsJournalPath()).size();
+    return journalSize >= 1024 * 1024 && journalSize * 8 >= QFileInfo(sessionsPath()).size();
+}
+
+bool Repository::beginSessionCompaction() const
+{
+    if (!QFileInfo::exists(sessionsCompactingPath()))
+        return QFileInfo(sessionsJournalPath()).size() > 0 && QFile::rename(sessionsJournalPath(), sessionsCompactingPath());
+
+    // 上次压缩未完成（例如程序中途退出），把新日志并入待压缩文件后重新压缩
+    QFile journal(sessionsJournalPath());
+    if (!journal.exists())
+        return true;
+    if (!journal.open(QIODevice::ReadOnly))
+        return false;
+    const QByteArray pending = journal.readAll();
+    journal.close();
+
+    QFile compacting(sessionsCompactingPath());
+    if (!compacting.open(QIODevice::ReadOnly))
+        return false;
+    QByteArray merged = compacting.readAll();
+    compacting.close();
+    merged.truncate(merged.lastIndexOf('\n') + 1);
+    merged += pending.first(pending.lastIndexOf('\n') + 1);
+
+    QSaveFile out(sessionsCompactingPath());
+    if (!out.open(QIODevice::WriteOnly) || out.write(merged) != merged.size() || !out.commit())
+        return false;
+    return QFile::remove(sessionsJournalPath());
+}
+
+bool Repository::finishSessionCompaction(const std::vector<Session> &sessions) const
+{
+    const qint64 sequence = std::max(SessionJournal::baseSequence(sessionsPath()),
+                                     SessionJournal::lastSequence(sessionsCompactingPath()));
+    if (!writeSessionsBase(sessions, sequence))
+        return false;
+    return QFile::remove(sessionsCompactingPath());
+}
+
+bool Repository::saveSessionPartitions(const std::vector<Session> &sessions, const std::vector<QDate> &months,
+                                       const QDate &residentFrom) const
+{
+    if (!QDir().mkpath(sessionsPartitionDir()))
+        return false;
+
+    const QDate from = residentFrom.isValid() ? QDate(residentFrom.year(), residentFrom.month(), 1) : QDate();
+    QHash<QDate, std::vector<const Session *>> rowsByMonth;
+    for (const QDate &month : months)
+    {
+        const QDate first(month.year(), month.month(), 1);
+        if (!from.isValid() || first >= from)
+            rowsByMonth.insert(first, {});
+    }
+
+    // 只驻留部分月份时，更早开始的跨月会话以磁盘上的 spill.csv 为准
+    std::vector<Session> earlierSpill;
+    if (from.isValid())
+    {
+        earlierSpill = sessionsFromCsv(sessionsSpillPath());
+        earlierSpill.erase(std::remove_if(earlierSpill.begin(), earlierSpill.end(), [&](const Session &session)
+                                          { return !session.begin.isValid() || monthOf(session.begin) >= from; }),
+                           earlierSpill.end());
+    }
+    std::vector<const Session *> spill;
+    for (const auto &session : earlierSpill)
+        spill.push_back(&session);
+    for (const auto &session : sessions)
+    {
+        if (!session.begin.isValid() || (from.isValid() && monthOf(session.begin) < from))
+            continue;
+        auto it = rowsByMonth.find(monthOf(session.begin));
+        if (it != rowsByMonth.end())
+            it->push_back(&session);
+        if (spillsOver(session))
+            spill.push_back(&session);
+    }
+
+    for (auto it = rowsByMonth.cbegin(); it != rowsByMonth.cend(); ++it)
+    {
+        if (!writeSessionRows(sessionsPartitionPath(it.key()), it.value()))
+            return false;
+    }
+    return writeSessionRows(sessionsSpillPath(), spill);
+}
+
+bool Repository::migrateSessionsToPartitions() const
+{
+    if (!QFileInfo::exists(sessionsPath()) && !QFileInfo::exists(sessionsJournalPath()) && !QFileInfo::exists(sessionsCompactingPath()))
+        return true;
+
+    // 先读出旧文件中的全部会话（含日志），分区写完后再删除旧文件
+    const std::vector<Session> sessions = loadFlatSessions();
+    if (!saveSessions(sessions))
+        return false;
+    QFile::remove(sessionsBinaryPath());
+    QFile::remove(sessionsCompactingPath());
+    QFile::remove(sessionsJournalPath());
+    return QFile::remove(sessionsPath());
+}
+
+bool Repository::enableSessionPartitions() const
+{
+    if (sessionsPartitioned())
+        return true;
+    return QDir().mkpath(sessionsPartitionDir()) && migrateSessionsToPartitions();
+}
+
+std::vector<BillLine> Repository::computeMonthlyStreaming(int year, int month, const std::vector<User> &users,
+                                                          qint64 blockBytes, QString *error) const
+{
+    MonthlyAccumulator accumulator(year, month, users);
+    const auto stream = [&](const QString &path, const std::function<bool(const Session &)> &accept)
+    {
+        if (!QFileInfo::exists(path))
+            return true;
+        const bool ok = Csv::forEachRecordStreamed(path, blockBytes, [&](QByteArrayView line)
+                                                   {
+            Session session;
+            if (sessionFromRecord(line, &session) && accept(session))
+                accumulator.add(session); });
+        if (!ok && error)
+            *error = QStringLiteral(u"读取上网记录失败：%1").arg(QDir::toNativeSeparators(path));
+        return ok;
+    };
+
+    if (sessionsPartitioned())
+    {
+        // 当月分区已包含当月开始的全部会话，跨月会话只补充更早开始的
+        const QDate target(year, month, 1);
+        const auto all = [](const Session &)
+        { return true; };
+        const auto earlier = [&](const Session &session)
+        { return monthOf(session.begin) < target && overlapsMonths(session, target, target); };
+        if (!stream(sessionsPartitionPath(target), all) || !stream(sessionsSpillPath(), earlier))
+            return {};
+        return accumulator.finish();
+    }
+
+    // 与 loadFlatSessions 相同，读取期间压缩提交导致序号变化时重新汇总
+    while (true)
+    {
+        const qint64 baseSequence = SessionJournal::baseSequence(sessionsPath());
+        // 快照有效时直接按映射区中的列汇总，不解析 CSV，也不构造 QDateTime 与 QString
+        SessionFile snapshot;
+        if (snapshot.open(sessionsBinaryPath()) && snapshot.matchesSource(QFileInfo(sessionsPath())))
+        {
+            std::vector<int> slots;
+            slots.reserve(snapshot.accounts().size());
+            for (const QString &account : snapshot.accounts())
+                slots.push_back(accumulator.slotOf(account));
+            const quint32 *ids = snapshot.accountIds();
+            const qint64 *begins = snapshot.beginSecs();
+            const qint64 *ends = snapshot.endSecs();
+            for (std::size_t i = 0; i < snapshot.size(); ++i)
+                accumulator.add(slots[ids[i]], begins[i], ends[i]);
+        }
+        else if (!stream(sessionsPath(), [](const Session &)
+                         { return true; }))
+            return {};
+        snapshot.close();
+
+        // 日志只保存上次压缩以来的变更，整体读入；删除的会话从汇总中扣回
+        std::vector<SessionChange> changes;
+        SessionJournal::read(sessionsCompactingPath(), baseSequence, &changes);
+        SessionJournal::read(sessionsJournalPath(), baseSequence, &changes);
+        if (SessionJournal::baseSequence(sessionsPath()) != baseSequence)
+        {
+            accumulator = MonthlyAccumulator(year, month, users);
+            continue;
+        }
+        for (const auto &change : changes)
+            accumulator.add(change.session, change.op == SessionChange::Op::Insert ? 1 : -1);
+        return accumulator.finish();
+    }
+}
+
+TariffCatalog Repository::loadTariffs(QString *error) const
+{
+    const auto fail = [&](const QString &msg) {
+        if (error)
+            *error = msg;
+        return TariffCatalog::builtin();
+    };
+
+    QFile file(tariffsPath());
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return TariffCatalog::builtin();
+
+    QTextStream in(&file);
+    in.setEncoding(QStringConverter::Utf8);
+    std::vector<TariffPlan> plans;
+    QString line;
+    int lineNo = 0;
+    while (in.readLineInto(&line))
+    {
+        ++lineNo;
+        line = line.trimmed();
+        if (line.isEmpty() || line.startsWith(QLatin1Char('#')))
+            continue;
+        const QStringList parts = Csv::parseLine(line);
+        if (parts.value(0).trimmed().compare(QStringLiteral("id"), Qt::CaseInsensitive) == 0)
+            continue;
+        if (parts.size() < 5)
+            return fail(QStringLiteral(u"tariffs.csv 第 %1 行字段不足。").arg(lineNo));
+
+        bool idOk = false;
+        bool baseOk = false;
+        bool minutesOk = false;
+        bool priceOk = false;
+        TariffPlan plan;
+        plan.id = parts.value(0).trimmed().toInt(&idOk);
+        plan.name = parts.value(1).trimmed();
+        plan.baseFee = Money::parse(parts.value(2).trimmed(), &baseOk);
+        plan.includedMinutes = parts.value(3).trimmed().toInt(&minutesOk);
+        plan.pricePerMinute = Money::parse(parts.value(4).trimmed(), &priceOk);
+        plan.description = parts.value(5).trimmed();
+        if (!idOk || !baseOk || !minutesOk || !priceOk)
+            return fail(QStringLiteral(u"tariffs.csv 第 %1 行数值无效。").arg(lineNo));
+        plans.push_back(std::move(plan));
+    }
+
+    TariffCatalog catalog;
+    QString reason;
+    if (!TariffCatalog::fromPlans(std::move(plans), &catalog, &reason))
+        return fail(QStringLiteral(u"tariffs.csv 无效：%1").arg(reason));
+    return catalog;
+}
+
+bool Repository::saveTariffs(const TariffCatalog &catalog) const
 {
     QDir().mkpath(m_dataDir);
-    QFile file(sessionsPath());
+    QSaveFile file(tariffsPath());
     if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
         return false;
 
     QTextStream out(&file);
     out.setEncoding(QStringConverter::Utf8);
-    writeCsvRow(out,
-                {QStringLiteral("account"),
-                 QStringLiteral("begin"),
-                 QStringLiteral("end")});
-    for (const auto &session : sessions)
+    Csv::writeRow(out,
+                  {QStringLiteral("id"),
+                   QStringLiteral("name"),
+                   QStringLiteral("base_fee"),
+                   QStringLiteral("included_minutes"),
+                   QStringLiteral("price_per_minute"),
+                   QStringLiteral("description")});
+    for (const auto &plan : catalog.plans())
     {
-        writeCsvRow(out,
-                    {session.account,
-                     formatCompact(session.begin),
-                     formatCompact(session.end)});
+        Csv::writeRow(out,
+                      {QString::number(plan.id),
+                       plan.name,
+                       plan.baseFee.toString(),
+                       QString::number(plan.includedMinutes),
+                       plan.pricePerMinute.toString(),
+                       plan.description});
     }
-    return true;
+    out.flush();
+    return file.commit();
 }
 
 bool Repository::writeMonthlyBill(int year, int month, const std::vector<BillLine> &lines) const
@@ -305,79 +1258,29 @@ bool Repository::writeMonthlyBill(int year, int month, const std::vector<BillLin
     if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
         return false;
 
-    QTextStream out(&file);
-    out.setEncoding(QStringConverter::Utf8);
-    writeCsvRow(out, {QStringLiteral("account"), QStringLiteral("name"), QStringLiteral("plan"), QStringLiteral("minutes"), QStringLiteral("amount")});
+    Csv::Writer out(&file);
+    out.field(u"account").field(u"name").field(u"plan").field(u"minutes").field(u"amount").endRow();
     for (const auto &line : lines)
-    {
-        writeCsvRow(out,
-                    {line.account,
-                     line.name,
-                     QString::number(line.plan),
-                     QString::number(line.minutes),
-                     QString::number(line.amount, 'f', 2)});
-    }
-    return true;
+        out.field(line.account).field(line.name).field(line.plan).field(line.minutes).fixed(line.amount.cents(), 2).endRow();
+    return out.finish();
 }
 
 std::vector<RechargeRecord> Repository::loadRechargeRecords() const
 {
-    std::vector<RechargeRecord> records;
-    QFile file(billsPath());
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
-        return records;
+    Csv::MappedFile file(billsPath());
+    if (!file.isOpen())
+        return {};
 
-    QTextStream in(&file);
-    in.setEncoding(QStringConverter::Utf8);
-    QString line;
-    while (in.readLineInto(&line))
+    // 备注可能含换行，按 CSV 记录而不是按行切分
+    const auto parseChunk = [](QByteArrayView chunk, std::vector<RechargeRecord> &records)
     {
-        line = line.trimmed();
-        if (line.isEmpty())
-            continue;
-        RechargeRecord record;
-        const QStringList parts = parseCsvLine(line);
-        if (parts.size() >= 6)
-        {
-            if (parts.value(0).trimmed().compare(QStringLiteral("account"), Qt::CaseInsensitive) == 0)
-                continue;
-            record.account = parts.value(0).trimmed();
-            record.timestamp = QDateTime::fromString(parts.value(1).trimmed(), Qt::ISODate);
-            record.amount = parts.value(2).trimmed().toDouble();
-            record.operatorAccount = parts.value(3).trimmed();
-            record.note = parts.value(4).trimmed();
-            record.balanceAfter = parts.value(5).trimmed().toDouble();
-        }
-        else
-        {
-            QStringList tokens = line.split(QRegularExpression(QStringLiteral("\\s+")), Qt::SkipEmptyParts);
-            if (tokens.size() < 5)
-                continue;
-
-            const QString balanceToken = tokens.takeLast();
-            record.balanceAfter = balanceToken.toDouble();
-
-            if (tokens.size() < 4)
-                continue;
-
-            record.account = tokens.value(0).trimmed();
-            if (record.account.compare(QStringLiteral("account"), Qt::CaseInsensitive) == 0)
-                continue;
-            record.timestamp = QDateTime::fromString(tokens.value(1).trimmed(), Qt::ISODate);
-            record.amount = tokens.value(2).toDouble();
-            record.operatorAccount = tokens.value(3).trimmed();
-            if (tokens.size() > 4)
-                record.note = tokens.mid(4).join(QStringLiteral(" ")).trimmed();
-            else
-                record.note.clear();
-        }
-
-        if (!record.timestamp.isValid())
-            record.timestamp = QDateTime::currentDateTime();
-
-        records.push_back(std::move(record));
-    }
-    return records;
+        Csv::forEachRecord(chunk, [&](QByteArrayView line)
+                           {
+            RechargeRecord record;
+            if (rechargeFromText(QString::fromUtf8(line.data(), line.size()).trimmed(), &record))
+                records.push_back(std::move(record)); });
+    };
+    return Csv::parseChunked<RechargeRecord>(file.data(), parseChunk);
 }
 
 bool Repository::saveRechargeRecords(const std::vector<RechargeRecord> &records) const
@@ -387,57 +1290,66 @@ bool Repository::saveRechargeRecords(const std::vector<RechargeRecord> &records)
     if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
         return false;
 
-    QTextStream out(&file);
-    out.setEncoding(QStringConverter::Utf8);
-    writeCsvRow(out,
-                {QStringLiteral("account"),
-                 QStringLiteral("timestamp"),
-                 QStringLiteral("amount"),
-                 QStringLiteral("operator"),
-                 QStringLiteral("note"),
-                 QStringLiteral("balance_after")});
+    Csv::Writer out(&file);
+    writeRechargeHeader(out);
     for (const auto &record : records)
-    {
-        writeCsvRow(out,
-                    {record.account,
-                     record.timestamp.toString(Qt::ISODate),
-                     QString::number(record.amount, 'f', 2),
-                     record.operatorAccount,
-                     record.note,
-                     QString::number(record.balanceAfter, 'f', 2)});
-    }
-    return true;
+        writeRechargeRow(out, record);
+    return out.finish();
 }
 
 bool Repository::appendRechargeRecord(const RechargeRecord &record) const
 {
+    return appendRechargeRecords({record});
+}
+
+bool Repository::appendRechargeRecords(const std::vector<RechargeRecord> &records) const
+{
+    if (records.empty())
+        return true;
+
     QDir().mkpath(m_dataDir);
     QFile file(billsPath());
     if (!file.open(QIODevice::Append | QIODevice::Text))
         return false;
 
-    const bool needsHeader = file.size() == 0;
+    Csv::Writer out(&file);
+    if (file.size() == 0)
+        writeRechargeHeader(out);
+    for (const auto &record : records)
+        writeRechargeRow(out, record);
+    return out.finish();
+}
 
-    QTextStream out(&file);
-    out.setEncoding(QStringConverter::Utf8);
-    if (needsHeader)
-    {
-        writeCsvRow(out,
-                    {QStringLiteral("account"),
-                     QStringLiteral("timestamp"),
-                     QStringLiteral("amount"),
-                     QStringLiteral("operator"),
-                     QStringLiteral("note"),
-                     QStringLiteral("balance_after")});
-    }
-    writeCsvRow(out,
-                {record.account,
-                 record.timestamp.toString(Qt::ISODate),
-                 QString::number(record.amount, 'f', 2),
-                 record.operatorAccount,
-                 record.note,
-                 QString::number(record.balanceAfter, 'f', 2)});
-    return true;
+std::vector<RechargeRequest> Repository::loadRechargeRequests(const QString &filePath, QStringList *errors)
+{
+    std::vector<RechargeRequest> requests;
+    Csv::MappedFile file(filePath);
+    if (!file.isOpen())
+    {
+        if (errors)
+            errors->append(QStringLiteral(u"无法打开文件：%1").arg(QDir::toNativeSeparators(filePath)));
+        return requests;
+    }
+
+    int record = 0;
+    Csv::forEachRecord(file.data(), [&](QByteArrayView line)
+                       {
+        ++record;
+        const QStringList parts = Csv::parseLine(QString::fromUtf8(line.data(), line.size()).trimmed());
+        const QString account = parts.value(0).trimmed();
+        if (account.isEmpty() || (record == 1 && account.compare(QStringLiteral("account"), Qt::CaseInsensitive) == 0))
+            return;
+
+        bool ok = false;
+        const Money amount = Money::parse(parts.value(1).trimmed(), &ok);
+        if (!ok)
+        {
+            if (errors)
+                errors->append(QStringLiteral(u"第 %1 条：金额“%2”无效").arg(record).arg(parts.value(1).trimmed()));
+            return;
+        }
+        requests.push_back(RechargeRequest{account, amount, parts.value(2).trimmed(), record}); });
+    return requests;
 }
 
 QString Repository::usersPath() const
@@ -445,16 +1357,74 @@ QString Repository::usersPath() const
     return m_dataDir + QStringLiteral("/users.csv");
 }
 
+QString Repository::usersLedgerPath() const
+{
+    return m_dataDir + QStringLiteral("/users.ledger");
+}
+
 QString Repository::sessionsPath() const
 {
     return m_dataDir + QStringLiteral("/sessions.csv");
 }
 
+QString Repository::sessionsBinaryPath() const
+{
+    return m_dataDir + QStringLiteral("/sessions.nbs");
+}
+
+QString Repository::sessionsJournalPath() const
+{
+    return m_dataDir + QStringLiteral("/sessions.journal");
+}
+
+QString Repository::sessionsCompactingPath() const
+{
+    return m_dataDir + QStringLiteral("/sessions.journal.compacting");
+}
+
+QString Repository::sessionsPartitionDir() const
+{
+    return m_dataDir + QStringLiteral("/sessions");
+}
+
+QString Repository::sessionsPartitionPath(const QDate &month) const
+{
+    return sessionsPartitionDir() + QLatin1Char('/') + month.toString(QStringLiteral("yyyy-MM")) + QStringLiteral(".csv");
+}
+
+QString Repository::sessionsSpillPath() const
+{
+    return sessionsPartitionDir() + QStringLiteral("/spill.csv");
+}
+
+bool Repository::sessionsPartitioned() const
+{
+    return QFileInfo(sessionsPartitionDir()).isDir();
+}
+
+std::vector<QDate> Repository::sessionPartitionMonths() const
+{
+    std::vector<QDate> months;
+    const QStringList names = QDir(sessionsPartitionDir()).entryList({QStringLiteral("????-??.csv")}, QDir::Files, QDir::Name);
+    for (const QString &name : names)
+    {
+        const QDate month = QDate::fromString(name.left(7), QStringLiteral("yyyy-MM"));
+        if (month.isValid())
+            months.push_back(month);
+    }
+    return months;
+}
+
 QString Repository::billsPath() const
 {
     return m_dataDir + QStringLiteral("/bills.csv");
 }
 
+QString Repository::tariffsPath() const
+{
+    return m_dataDir + QStringLiteral("/tariffs.csv");
+}
+
 QString Repository::outputDir() const
 {
     return m_outDir;
@@ -465,13 +1435,37 @@ QString Repository::dataDir() const
     return m_dataDir;
 }
 
-bool Repository::exportBackup(const QString &filePath, QString *error) const
+bool Repository::exportBackup(const QString &filePath, QString *error, int compressionLevel, BackupStats *stats,
+                              const BackupProgress &progress) const
+{
+    return writeBackupArchive(filePath, QString(), compressionLevel, stats, progress, error);
+}
+
+bool Repository::exportIncrementalBackup(const QString &filePath, const QString &basePath, QString *error,
+                                         int compressionLevel, BackupStats *stats, const BackupProgress &progress) const
+{
+    return writeBackupArchive(filePath, basePath, compressionLevel, stats, progress, error);
+}
+
+bool Repository::isIncrementalBase(const QString &archivePath)
+{
+    QJsonObject manifest;
+    return readManifest(archivePath, &manifest, nullptr);
+}
+
+bool Repository::writeBackupArchive(const QString &filePath, const QString &basePath, int compressionLevel,
+                                    BackupStats *statsOut, const BackupProgress &progress, QString *error) const
 {
     const auto setError = [&](const QString &msg) {
         if (error)
             *error = msg;
     };
 
+    QElapsedTimer timer;
+    timer.start();
+    BackupStats stats;
+    compressionLevel = std::clamp(compressionLevel, 0, 9);
+
     QDir dir(m_dataDir);
     if (!dir.exists())
     {
@@ -482,32 +1476,36 @@ bool Repository::exportBackup(const QString &filePath, QString *error) const
         }
     }
 
-    QJsonArray filesArray;
-    const QFileInfoList entries = dir.entryInfoList(QDir::Files | QDir::NoSymLinks | QDir::Readable);
-    for (const QFileInfo &info : entries)
+    // 基准清单中的块位置以归档文件名记录，增量备份须与基准位于同一目录
+    QString baseName;
+    QHash<QString, QJsonObject> baseFiles;
+    if (!basePath.isEmpty())
     {
-        QFile file(info.absoluteFilePath());
-        if (!file.open(QIODevice::ReadOnly))
+        const QFileInfo baseInfo(basePath);
+        if (baseInfo.absolutePath() != QFileInfo(filePath).absolutePath() || baseInfo.fileName() == QFileInfo(filePath).fileName())
         {
-            setError(QStringLiteral(u"无法读取文件：%1").arg(info.fileName()));
+            setError(QStringLiteral(u"增量备份须与基准备份位于同一目录且文件名不同。"));
             return false;
         }
-
-        const QByteArray data = file.readAll();
-        QJsonObject fileObject;
-        fileObject.insert(QStringLiteral("name"), info.fileName());
-        fileObject.insert(QStringLiteral("size"), static_cast<qint64>(data.size()));
-        fileObject.insert(QStringLiteral("sha256"),
-                          QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Sha256).toHex()));
-        fileObject.insert(QStringLiteral("data"), QString::fromLatin1(data.toBase64()));
-        filesArray.append(fileObject);
+        QJsonObject baseManifest;
+        if (!readManifest(basePath, &baseManifest, error))
+            return false;
+        baseName = baseInfo.fileName();
+        for (const QJsonValue &value : baseManifest.value(QStringLiteral("files")).toArray())
+        {
+            const QJsonObject fileObject = value.toObject();
+            baseFiles.insert(fileObject.value(QStringLiteral("name")).toString(), fileObject);
+        }
     }
+    const auto inherited = [&](QJsonObject block)
+    {
+        block.insert(QStringLiteral("archive"), blockArchive(block, baseName));
+        return block;
+    };
 
-    QJsonObject root;
-    root.insert(QStringLiteral("version"), 1);
-    root.insert(QStringLiteral("createdAt"), QDateTime::currentDateTimeUtc().toString(Qt::ISODate));
-    root.insert(QStringLiteral("fileCount"), filesArray.size());
-    root.insert(QStringLiteral("files"), filesArray);
+    QFileInfoList entries = dir.entryInfoList(QDir::Files | QDir::NoSymLinks | QDir::Readable);
+    if (sessionsPartitioned())
+        entries += QDir(sessionsPartitionDir()).entryInfoList(QDir::Files | QDir::NoSymLinks | QDir::Readable);
 
     QSaveFile out(filePath);
     if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate))
@@ -516,8 +1514,130 @@ bool Repository::exportBackup(const QString &filePath, QString *error) const
         return false;
     }
 
-    const QByteArray payload = QJsonDocument(root).toJson(QJsonDocument::Indented);
-    if (out.write(payload) != payload.size())
+    QDataStream stream(&out);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream.writeRawData(kArchiveMagic.constData(), kArchiveMagic.size());
+    stream << kManifestArchiveVersion << QDateTime::currentMSecsSinceEpoch();
+
+    // 二进制会话快照可由 sessions.csv 重建，不纳入备份
+    const QString snapshotPath = QFileInfo(sessionsBinaryPath()).absoluteFilePath();
+    qint64 totalBytes = 0;
+    for (const QFileInfo &info : entries)
+        totalBytes += info.absoluteFilePath() == snapshotPath ? 0 : info.size();
+    qint64 doneBytes = 0;
+    const auto advance = [&](qint64 bytes)
+    {
+        doneBytes += bytes;
+        if (!progress || progress(doneBytes, totalBytes))
+            return true;
+        setError(QStringLiteral(u"备份已取消。"));
+        return false;
+    };
+
+    QByteArray buffer(kArchiveChunkBytes, Qt::Uninitialized);
+    QByteArray compressed;
+    QJsonArray filesArray;
+    for (const QFileInfo &info : entries)
+    {
+        if (info.absoluteFilePath() == snapshotPath)
+            continue;
+
+        // 分区文件以 "sessions/2025-10.csv" 这样的相对路径记录
+        const QString name = dir.relativeFilePath(info.absoluteFilePath());
+        const qint64 modified = info.lastModified().toMSecsSinceEpoch();
+        const auto base = baseFiles.constFind(name);
+        QJsonObject fileObject;
+        fileObject.insert(QStringLiteral("name"), name);
+        fileObject.insert(QStringLiteral("size"), info.size());
+        fileObject.insert(QStringLiteral("modified"), modified);
+        QJsonArray blocks;
+
+        if (base != baseFiles.constEnd() && base->value(QStringLiteral("size")).toInteger() == info.size()
+            && base->value(QStringLiteral("modified")).toInteger() == modified)
+        {
+            // 大小与修改时间都没变，不读取文件，整体引用基准中的块
+            for (const QJsonValue &block : base->value(QStringLiteral("blocks")).toArray())
+                blocks.append(inherited(block.toObject()));
+            fileObject.insert(QStringLiteral("sha256"), base->value(QStringLiteral("sha256")));
+            if (!advance(info.size()))
+                return false;
+        }
+        else
+        {
+            QFile file(info.absoluteFilePath());
+            if (!file.open(QIODevice::ReadOnly))
+            {
+                setError(QStringLiteral(u"无法读取文件：%1").arg(info.fileName()));
+                return false;
+            }
+
+            const QJsonArray baseBlocks = base != baseFiles.constEnd() ? base->value(QStringLiteral("blocks")).toArray() : QJsonArray();
+            QCryptographicHash hash(QCryptographicHash::Sha256);
+            for (qsizetype index = 0;; ++index)
+            {
+                const qint64 length = file.read(buffer.data(), buffer.size());
+                if (length < 0)
+                {
+                    setError(QStringLiteral(u"无法读取文件：%1").arg(info.fileName()));
+                    return false;
+                }
+                if (length == 0)
+                    break;
+
+                const QByteArrayView chunk(buffer.constData(), length);
+                const QString blockHash = hexDigest(chunk);
+                hash.addData(chunk);
+                if (!advance(length))
+                    return false;
+                const QJsonObject baseBlock = baseBlocks.at(index).toObject();
+                if (baseBlock.value(QStringLiteral("sha256")).toString() == blockHash
+                    && baseBlock.value(QStringLiteral("length")).toInteger() == length)
+                {
+                    blocks.append(inherited(baseBlock));
+                    continue;
+                }
+
+                QJsonObject block;
+                block.insert(QStringLiteral("sha256"), blockHash);
+                block.insert(QStringLiteral("length"), length);
+                block.insert(QStringLiteral("offset"), out.pos());
+                QByteArrayView stored = chunk;
+                if (compressionLevel > 0)
+                {
+                    compressed = qCompress(reinterpret_cast<const uchar *>(chunk.data()), static_cast<qsizetype>(length), compressionLevel);
+                    if (compressed.size() < length)
+                    {
+                        stored = compressed;
+                        block.insert(QStringLiteral("compressed"), true);
+                        block.insert(QStringLiteral("stored"), compressed.size());
+                    }
+                }
+                blocks.append(block);
+                stream.writeRawData(stored.data(), static_cast<int>(stored.size()));
+                stats.rawBytes += length;
+                stats.storedBytes += stored.size();
+            }
+            fileObject.insert(QStringLiteral("sha256"), QString::fromLatin1(hash.result().toHex()));
+        }
+        fileObject.insert(QStringLiteral("blocks"), blocks);
+        filesArray.append(fileObject);
+    }
+
+    QJsonObject manifest;
+    manifest.insert(QStringLiteral("version"), static_cast<int>(kManifestArchiveVersion));
+    manifest.insert(QStringLiteral("createdAt"), QDateTime::currentDateTimeUtc().toString(Qt::ISODate));
+    manifest.insert(QStringLiteral("base"), baseName);
+    manifest.insert(QStringLiteral("blockSize"), kArchiveChunkBytes);
+    manifest.insert(QStringLiteral("compressionLevel"), compressionLevel);
+    manifest.insert(QStringLiteral("fileCount"), filesArray.size());
+    manifest.insert(QStringLiteral("files"), filesArray);
+    const QByteArray manifestData = QJsonDocument(manifest).toJson(QJsonDocument::Compact);
+    const qint64 manifestOffset = out.pos();
+    stream.writeRawData(manifestData.constData(), static_cast<int>(manifestData.size()));
+    stream << manifestOffset << static_cast<qint64>(manifestData.size());
+    stream.writeRawData(kManifestMagic.constData(), kManifestMagic.size());
+
+    if (stream.status() != QDataStream::Ok)
     {
         setError(QStringLiteral(u"写入备份数据失败。"));
         return false;
@@ -527,6 +1647,9 @@ bool Repository::exportBackup(const QString &filePath, QString *error) const
         setError(QStringLiteral(u"提交备份文件失败。"));
         return false;
     }
+    stats.elapsedMs = timer.elapsed();
+    if (statsOut)
+        *statsOut = stats;
     return true;
 }
 
@@ -538,94 +1661,230 @@ bool Repository::importBackup(const QString &filePath, QString *error)
     };
 
     QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    if (!file.open(QIODevice::ReadOnly))
     {
         setError(QStringLiteral(u"无法打开备份文件：%1").arg(QDir::toNativeSeparators(filePath)));
         return false;
     }
 
-    const QByteArray raw = file.readAll();
-    QJsonParseError parseError{};
-    const auto document = QJsonDocument::fromJson(raw, &parseError);
-    if (parseError.error != QJsonParseError::NoError || !document.isObject())
-    {
-        setError(QStringLiteral(u"备份文件格式错误：%1").arg(parseError.errorString()));
-        return false;
-    }
-
-    const QJsonObject root = document.object();
-    const QJsonArray files = root.value(QStringLiteral("files")).toArray();
-
-    QDir dir(m_dataDir);
-    if (!dir.exists() && !dir.mkpath(QStringLiteral(".")))
-    {
-        setError(QStringLiteral(u"无法创建数据目录：%1").arg(QDir::toNativeSeparators(m_dataDir)));
-        return false;
-    }
-
-    for (const QJsonValue &value : files)
+    // 版本 2、3 为归档格式；其余按版本 1 的 JSON 文档整体解析
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_0);
+    QJsonArray files;
+    QJsonObject manifest;
+    quint32 version = 0;
+    const bool archive = file.peek(kArchiveMagic.size()) == kArchiveMagic;
+    if (archive)
     {
-        if (!value.isObject())
-        {
-            setError(QStringLiteral(u"备份文件包含无效条目。"));
-            return false;
-        }
-
-        const QJsonObject fileObject = value.toObject();
-        const QString name = fileObject.value(QStringLiteral("name")).toString();
-        if (name.isEmpty())
-        {
-            setError(QStringLiteral(u"备份文件包含空文件名。"));
-            return false;
-        }
-
-        const QString encoded = fileObject.value(QStringLiteral("data")).toString();
-        QByteArray data = QByteArray::fromBase64(encoded.toLatin1());
-        if (!encoded.isEmpty() && data.isEmpty() && fileObject.value(QStringLiteral("size")).toInt() > 0)
+        qint64 createdAt = 0;
+        stream.skipRawData(kArchiveMagic.size());
+        stream >> version >> createdAt;
+        if (stream.status() != QDataStream::Ok || (version != kStreamArchiveVersion && version != kManifestArchiveVersion))
         {
-            setError(QStringLiteral(u"备份内容损坏：%1").arg(name));
+            setError(QStringLiteral(u"不支持的备份版本：%1").arg(version));
             return false;
         }
-
-        const QString hashValue = fileObject.value(QStringLiteral("sha256")).toString();
-        if (!hashValue.isEmpty())
+        if (version == kManifestArchiveVersion)
         {
-            const QByteArray expected = QByteArray::fromHex(hashValue.toLatin1());
-            if (!expected.isEmpty())
+            if (!readManifest(filePath, &manifest, error))
+                return false;
+            // 清理现有数据前先确认基准链上的归档都在
+            const QFileInfo archiveInfo(filePath);
+            for (const QJsonValue &fileValue : manifest.value(QStringLiteral("files")).toArray())
             {
-                const QByteArray actual = QCryptographicHash::hash(data, QCryptographicHash::Sha256);
-                if (actual != expected)
+                for (const QJsonValue &block : fileValue.toObject().value(QStringLiteral("blocks")).toArray())
                 {
-                    setError(QStringLiteral(u"备份校验失败：%1").arg(name));
-                    return false;
+                    const QString name = blockArchive(block.toObject(), archiveInfo.fileName());
+                    if (!QFileInfo::exists(archiveInfo.absoluteDir().filePath(name)))
+                    {
+                        setError(QStringLiteral(u"缺少基准备份：%1").arg(name));
+                        return false;
+                    }
                 }
             }
         }
-
-        const QFileInfo targetInfo(dir.filePath(name));
-        if (!QDir().mkpath(targetInfo.path()))
+    }
+    else
+    {
+        QJsonParseError parseError{};
+        const auto document = QJsonDocument::fromJson(file.readAll(), &parseError);
+        if (parseError.error != QJsonParseError::NoError || !document.isObject())
         {
-            setError(QStringLiteral(u"无法创建目标目录：%1").arg(targetInfo.path()));
+            setError(QStringLiteral(u"备份文件格式错误：%1").arg(parseError.errorString()));
             return false;
         }
+        files = document.object().value(QStringLiteral("files")).toArray();
+    }
 
-        QSaveFile out(targetInfo.absoluteFilePath());
-        if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate))
-        {
-            setError(QStringLiteral(u"无法恢复文件：%1").arg(name));
-            return false;
-        }
-        if (!data.isEmpty() && out.write(data) != data.size())
-        {
-            setError(QStringLiteral(u"写入文件失败：%1").arg(name));
+    // 先在暂存目录中完整恢复并校验，全部成功后再换入数据目录，失败时数据目录保持不变
+    const QString staging = restoreStagingDir();
+    QDir stagingDir(staging);
+    stagingDir.removeRecursively();
+    if (!stagingDir.mkpath(QStringLiteral(".")))
+    {
+        setError(QStringLiteral(u"无法创建暂存目录：%1").arg(QDir::toNativeSeparators(staging)));
+        return false;
+    }
+
+    bool restored = false;
+    if (!archive)
+        restored = restoreJsonFiles(files, stagingDir, error);
+    else if (version == kStreamArchiveVersion)
+        restored = restoreArchive(stream, stagingDir, error);
+    else
+        restored = restoreManifest(filePath, manifest, stagingDir, error);
+    if (!restored)
+    {
+        stagingDir.removeRecursively();
+        return false;
+    }
+
+    // 只换入备份中的条目，备份之外的文件与目录原样留在数据目录中；二进制快照、日志与
+    // 恢复后的 sessions.csv 不再对应，一并移开；存储方式以备份为准，备份不含分区时移开 sessions/
+    QStringList install = stagingDir.entryList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System);
+    QStringList drop;
+    for (const QString &path : {sessionsBinaryPath(), sessionsJournalPath(), sessionsCompactingPath(), usersLedgerPath(), sessionsPartitionDir()})
+    {
+        const QString name = QFileInfo(path).fileName();
+        if (!install.contains(name))
+            drop.append(name);
+    }
+
+    // 被替换的条目移入 .replaced，应用重新加载成功后由 discardReplacedData 删除
+    const QString replaced = restoreReplacedDir();
+    QDir(replaced).removeRecursively();
+    if (!QDir().mkpath(m_dataDir) || !QDir().mkpath(replaced) || !writeRestorePlan(install, drop))
+    {
+        stagingDir.removeRecursively();
+        QDir().rmdir(replaced);
+        setError(QStringLiteral(u"无法替换数据目录：%1").arg(QDir::toNativeSeparators(m_dataDir)));
+        return false;
+    }
+    if (!installRestoredEntries(install, drop))
+    {
+        rollBackRestoredEntries(install, drop);
+        QFile::remove(restorePlanPath());
+        QDir().rmdir(replaced);
+        stagingDir.removeRecursively();
+        setError(QStringLiteral(u"无法替换数据目录：%1").arg(QDir::toNativeSeparators(m_dataDir)));
+        return false;
+    }
+    QFile::remove(restorePlanPath());
+    QDir().rmdir(staging);
+    m_userLedger->reset();
+    return true;
+}
+
+void Repository::discardReplacedData() const
+{
+    QDir(restoreReplacedDir()).removeRecursively();
+}
+
+QString Repository::restoreStagingDir() const
+{
+    return QDir::cleanPath(m_dataDir) + QStringLiteral(".restoring");
+}
+
+QString Repository::restoreReplacedDir() const
+{
+    return QDir::cleanPath(m_dataDir) + QStringLiteral(".replaced");
+}
+
+QString Repository::restorePlanPath() const
+{
+    return restoreReplacedDir() + QStringLiteral("/.restore-plan");
+}
+
+bool Repository::writeRestorePlan(const QStringList &install, const QStringList &drop) const
+{
+    QSaveFile file(restorePlanPath());
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+        return false;
+    QTextStream out(&file);
+    out.setEncoding(QStringConverter::Utf8);
+    for (const QString &name : install)
+        out << "install," << name << '\n';
+    for (const QString &name : drop)
+        out << "drop," << name << '\n';
+    out.flush();
+    return file.commit();
+}
+
+bool Repository::installRestoredEntries(const QStringList &install, const QStringList &drop) const
+{
+    const QDir live(m_dataDir);
+    const QDir staging(restoreStagingDir());
+    const QDir replaced(restoreReplacedDir());
+    const auto present = [](const QDir &dir, const QString &name)
+    {
+        const QFileInfo info(dir.filePath(name));
+        return info.exists() || info.isSymLink();
+    };
+
+    // 每一步都可重复执行：已移开或已换入的条目跳过，中断后按计划从头再做一遍即可
+    for (const QString &name : install + drop)
+    {
+        if (install.contains(name) && !present(staging, name))
+            continue;
+        if (present(live, name) && !present(replaced, name) && !QDir().rename(live.filePath(name), replaced.filePath(name)))
             return false;
-        }
-        if (!out.commit())
-        {
-            setError(QStringLiteral(u"提交文件失败：%1").arg(name));
+    }
+    for (const QString &name : install)
+    {
+        if (present(staging, name) && !QDir().rename(staging.filePath(name), live.filePath(name)))
             return false;
-        }
     }
-
     return true;
 }
+
+void Repository::rollBackRestoredEntries(const QStringList &install, const QStringList &drop) const
+{
+    const QDir live(m_dataDir);
+    const QDir staging(restoreStagingDir());
+    const QDir replaced(restoreReplacedDir());
+    for (const QString &name : install)
+    {
+        if (!QFileInfo::exists(staging.filePath(name)) && QFileInfo::exists(live.filePath(name)))
+            QDir().rename(live.filePath(name), staging.filePath(name));
+    }
+    for (const QString &name : install + drop)
+    {
+        if (QFileInfo::exists(replaced.filePath(name)))
+            QDir().rename(replaced.filePath(name), live.filePath(name));
+    }
+}
+
+void Repository::recoverInterruptedRestore() const
+{
+    // 计划文件在暂存目录校验完成后才写入：计划存在说明换入途中被中断，暂存的内容是完整的，
+    // 按计划继续换入；没有计划的暂存目录是未完成的恢复，直接丢弃
+    const QString staging = restoreStagingDir();
+    if (!QFileInfo::exists(staging))
+        return;
+
+    QFile plan(restorePlanPath());
+    if (!plan.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        QDir(staging).removeRecursively();
+        return;
+    }
+    QStringList install;
+    QStringList drop;
+    QTextStream in(&plan);
+    in.setEncoding(QStringConverter::Utf8);
+    while (!in.atEnd())
+    {
+        const QString line = in.readLine();
+        if (line.startsWith(QLatin1String("install,")))
+            install.append(line.mid(8));
+        else if (line.startsWith(QLatin1String("drop,")))
+            drop.append(line.mid(5));
+    }
+    plan.close();
+    if (installRestoredEntries(install, drop))
+    {
+        QFile::remove(restorePlanPath());
+        QDir().rmdir(staging);
+    }
+}
+}
@@ -1,33 +1,159 @@
 #pragma once
 
 #include "Models.h"
+#include "backend/Billing.h"
+#include "backend/SessionJournal.h"
+#include "backend/TariffCatalog.h"
+#include "backend/WriteAheadLog.h"
+
+#include <functional>
+#include <memory>
+
+// 用户信息的变更，写入 users.ledger 后再定期并入 users.csv
+struct UserChange
+{
+    enum class Op : char
+    {
+        Balance = 'B', // 只更新余额（充值、扣费）
+        Upsert = 'U',  // 新增或整体替换同账号用户
+        Remove = 'D'
+    };
+
+    Op op{Op::Upsert};
+    User user; // Balance 只用 account 与 balance，Remove 只用 account
+};
+
+// 导出备份的统计：rawBytes 为本次写入归档的块的原始大小（引用基准的块不计），
+// storedBytes 为这些块在归档中实际占用的大小
+struct BackupStats
+{
+    qint64 rawBytes{0};
+    qint64 storedBytes{0};
+    qint64 elapsedMs{0};
+
+    double ratio() const { return storedBytes > 0 ? static_cast<double>(rawBytes) / static_cast<double>(storedBytes) : 1.0; }
+    double megabytesPerSecond() const
+    {
+        return elapsedMs > 0 ? static_cast<double>(rawBytes) / (1024.0 * 1024.0) / (static_cast<double>(elapsedMs) / 1000.0) : 0.0;
+    }
+};
+
+using BackupProgress = std::function<bool(qint64 doneBytes, qint64 totalBytes)>;
 
 class Repository
 {
 public:
     explicit Repository(QString dataDir, QString outDir);
 
+    // 读取 users.csv 后重放 users.ledger 中尚未并入的变更
     std::vector<User> loadUsers() const;
+    // sessions.nbs 与 sessions.csv 一致时直接从二进制快照加载，否则解析 CSV；
+    // 随后依次重放压缩中的日志与 sessions.journal 中尚未并入的变更；分区模式下读取全部分区
     std::vector<Session> loadSessions() const;
+    // 与 [fromMonth, toMonth] 有交集的会话（按月，日忽略）：分区模式下只读取范围内的分区
+    // 与 spill.csv 中更早开始的跨月会话；toMonth 无效时不设上限
+    std::vector<Session> loadSessions(const QDate &fromMonth, const QDate &toMonth = QDate()) const;
+    // 供批量结算使用的列式会话，快照有效时直接复制映射区中的列
+    SessionColumns loadSessionColumns() const;
     std::vector<RechargeRecord> loadRechargeRecords() const;
 
+    // 检查点：整体重写 users.csv 并清空 users.ledger
     bool saveUsers(const std::vector<User> &users) const;
+    // 整批追加到 users.ledger 并落盘后返回，不重写 users.csv
+    bool commitUserChanges(const std::vector<UserChange> &changes, QString *error = nullptr) const;
+    // 日志超过 64 KiB 且达到 users.csv 的一半时建议做检查点
+    bool userLedgerNeedsCheckpoint() const;
+    // 整体重写 sessions.csv 并清空日志；分区模式下重写全部分区
     bool saveSessions(const std::vector<Session> &sessions) const;
+    // 分区模式：只重写 months 对应的分区（当月没有会话时删除分区文件）与 spill.csv。
+    // residentFrom 无效时 sessions 须为全部会话；有效时 sessions 为 loadSessions(residentFrom) 的结果，
+    // 早于 residentFrom 的分区不会重写，spill.csv 中更早开始的会话保留磁盘上的内容
+    bool saveSessionPartitions(const std::vector<Session> &sessions, const std::vector<QDate> &months,
+                               const QDate &residentFrom = QDate()) const;
+    // 分区模式下把残留的 sessions.csv（含日志）按月拆入分区后删除旧文件
+    bool migrateSessionsToPartitions() const;
+    // 建立分区目录并迁移现有会话，之后按月分区存储
+    bool enableSessionPartitions() const;
+    // 只把本次变更追加到 sessions.journal
+    bool appendSessionChanges(const std::vector<SessionChange> &changes, QString *error = nullptr) const;
+    // 日志超过 1 MiB 且达到基础文件的 1/8，或留有未完成的压缩时返回 true
+    bool sessionJournalNeedsCompaction() const;
+    // 压缩分两步：beginSessionCompaction 在调用线程将日志改名为待压缩文件，之后的变更写入新日志；
+    // finishSessionCompaction 可在后台线程执行，sessions 须为改名时刻的完整记录
+    bool beginSessionCompaction() const;
+    bool finishSessionCompaction(const std::vector<Session> &sessions) const;
     bool saveRechargeRecords(const std::vector<RechargeRecord> &records) const;
     bool appendRechargeRecord(const RechargeRecord &record) const;
+    // 整批追加到 bills.csv，只打开并写入一次文件
+    bool appendRechargeRecords(const std::vector<RechargeRecord> &records) const;
+    // 读取 account,amount,note 格式的批量充值文件（表头可选）；无法解析的记录写入 errors 并跳过，
+    // 账号是否存在由调用方校验
+    static std::vector<RechargeRequest> loadRechargeRequests(const QString &filePath, QStringList *errors);
+
+    // tariffs.csv 缺失或无效时返回内置套餐；error 仅在文件存在但无法使用时填写
+    TariffCatalog loadTariffs(QString *error = nullptr) const;
+    bool saveTariffs(const TariffCatalog &catalog) const;
 
+    // 不把会话读入内存：二进制快照有效时按其映射的列汇总，否则按块流式读取 sessions.csv，再重放日志
+    // （分区模式下只读当月分区与 spill.csv），直接汇总指定月份的账单，
+    // 结果与加载全部会话后调用 BillingEngine::computeMonthly 一致；堆内存只与用户数和 blockBytes 有关
+    std::vector<BillLine> computeMonthlyStreaming(int year, int month, const std::vector<User> &users,
+                                                  qint64 blockBytes = 4 * 1024 * 1024, QString *error = nullptr) const;
     bool writeMonthlyBill(int year, int month, const std::vector<BillLine> &lines) const;
 
-    bool exportBackup(const QString &filePath, QString *error) const;
+    // 备份归档按块读写，末尾附带记录每个文件与每个块 SHA-256 的清单，内存占用与数据量无关；
+    // 导入时仍可读取版本 1 的 JSON 备份与版本 2 的流式归档。
+    // compressionLevel 为 1–9 时逐块以 zlib 压缩（0 为不压缩）；stats 非空时填写压缩比与吞吐量
+    // progress 在每个块之后以已处理与总字节数调用，返回 false 时取消导出，不留下备份文件
+    bool exportBackup(const QString &filePath, QString *error, int compressionLevel = 0, BackupStats *stats = nullptr,
+                      const BackupProgress &progress = {}) const;
+    // 以 basePath（全量或增量备份）的清单为基准，只写入内容变化的块，未变的块引用基准链中的位置；
+    // 大小与修改时间都未变的文件不重新读取。恢复时需要链上的全部备份位于同一目录
+    bool exportIncrementalBackup(const QString &filePath, const QString &basePath, QString *error,
+                                 int compressionLevel = 0, BackupStats *stats = nullptr, const BackupProgress &progress = {}) const;
+    // 是否为带清单、可作增量基准的归档；旧版本备份或写了一半的文件返回 false
+    static bool isIncrementalBase(const QString &archivePath);
+    // 先在暂存目录中完整恢复并校验，再把备份中的条目逐个改名换入数据目录，备份之外的文件不受影响；
+    // 被替换的旧条目保留在 <数据目录>.replaced 中，应用重新加载成功后调用 discardReplacedData 删除
     bool importBackup(const QString &filePath, QString *error);
+    void discardReplacedData() const;
 
     QString usersPath() const;
+    QString usersLedgerPath() const;
     QString sessionsPath() const;
+    QString sessionsBinaryPath() const;
+    QString sessionsJournalPath() const;
+    QString sessionsCompactingPath() const;
+    // data/sessions/ 存在时启用按月分区：每月一个 YYYY-MM.csv，会话归入开始月份；
+    // 结束月份晚于开始月份的会话另记入 spill.csv，供后续月份查询
+    QString sessionsPartitionDir() const;
+    QString sessionsPartitionPath(const QDate &month) const;
+    QString sessionsSpillPath() const;
+    bool sessionsPartitioned() const;
     QString billsPath() const;
+    QString tariffsPath() const;
     QString outputDir() const;
     QString dataDir() const;
 
 private:
+    static void parseUsers(QByteArrayView data, std::vector<User> &users);
+    std::vector<Session> loadFlatSessions() const;
+    // 已有分区文件对应的月份，升序
+    std::vector<QDate> sessionPartitionMonths() const;
+    bool writeSessionsBase(const std::vector<Session> &sessions, qint64 sequence) const;
+    qint64 lastSessionSequence() const;
+    // 恢复备份时先写入暂存目录，完成后按计划把旧条目移入 .replaced、再把恢复的条目换入
+    QString restoreStagingDir() const;
+    QString restoreReplacedDir() const;
+    QString restorePlanPath() const;
+    bool writeRestorePlan(const QStringList &install, const QStringList &drop) const;
+    bool installRestoredEntries(const QStringList &install, const QStringList &drop) const;
+    void rollBackRestoredEntries(const QStringList &install, const QStringList &drop) const;
+    void recoverInterruptedRestore() const;
+    bool writeBackupArchive(const QString &filePath, const QString &basePath, int compressionLevel,
+                            BackupStats *statsOut, const BackupProgress &progress, QString *error) const;
+
     QString m_dataDir;
     QString m_outDir;
+    std::shared_ptr<WriteAheadLog> m_userLedger;
 };
@@ -9,6 +9,7 @@
 #include "ElaTheme.h"
 #include "backend/SettingsManager.h"
 #include "ui/ThemeUtils.h"
+#include "backend/billing.h"
 #include "backend/repository.h"
 #include "backend/security.h"
 #include "ui/dialogs/RegisterDialog.h"
@@ -38,6 +39,7 @@ LoginDialog::LoginDialog(QString dataDir, QString outDir, QWidget *parent)
                 toggleThemeMode(this);
                 m_uiSettings.themeMode = eTheme->getThemeMode();
                 persistUiPreferences(); });
+    BillingEngine::setTariffs(m_repository->loadTariffs());
     setupUi();
     loadUsers();
     ensureDefaultAdmin();
@@ -152,7 +154,7 @@ void LoginDialog::ensureDefaultAdmin()
     admin.passwordHash = Security::hashPassword(QStringLiteral("admin123"));
     admin.role = UserRole::Admin;
     admin.enabled = true;
-    admin.balance = 0.0;
+    admin.balance = Money();
     m_users.push_back(admin);
     saveUsers();
     m_createdDefaultAdmin = true;
@@ -257,7 +259,7 @@ void LoginDialog::handleRegister()
         return;
     }
     m_users.push_back(std::move(newUser));
-    if (!saveUsers())
+    if (!m_repository->commitUserChanges({UserChange{UserChange::Op::Upsert, m_users.back()}}))
     {
         showThemedWarning(this, windowTitle(), QStringLiteral(u"保存注册信息失败，请检查数据目录权限。"));
         m_users.pop_back();
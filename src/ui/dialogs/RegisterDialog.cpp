@@ -5,6 +5,7 @@
 #include "ElaLineEdit.h"
 #include "ElaPushButton.h"
 #include "ElaText.h"
+#include "backend/Billing.h"
 #include "backend/Security.h"
 #include "ui/ThemeUtils.h"
 
@@ -47,16 +48,11 @@ void RegistrationDialog::setupUi()
     formLayout->addRow(createFormLabel(QStringLiteral(u"账号"), this), m_accountEdit);
 
     m_planCombo = new ElaComboBox(this);
-    const auto appendPlanOption = [](ElaComboBox *combo, Tariff plan, const QString &text)
+    for (const auto &plan : BillingEngine::tariffs().plans())
     {
-        combo->addItem(text, QVariant::fromValue(static_cast<int>(plan)));
-        combo->setItemData(combo->count() - 1, tariffBillingDescription(plan), Qt::ToolTipRole);
-    };
-    appendPlanOption(m_planCombo, Tariff::NoDiscount, QStringLiteral(u"标准计费"));
-    appendPlanOption(m_planCombo, Tariff::Pack30h, QStringLiteral(u"30 小时套餐"));
-    appendPlanOption(m_planCombo, Tariff::Pack60h, QStringLiteral(u"60 小时套餐"));
-    appendPlanOption(m_planCombo, Tariff::Pack150h, QStringLiteral(u"150 小时套餐"));
-    appendPlanOption(m_planCombo, Tariff::Unlimited, QStringLiteral(u"包月不限时"));
+        m_planCombo->addItem(plan.name, QVariant::fromValue(plan.id));
+        m_planCombo->setItemData(m_planCombo->count() - 1, plan.description, Qt::ToolTipRole);
+    }
     formLayout->addRow(createFormLabel(QStringLiteral(u"计费套餐"), this), m_planCombo);
 
     m_passwordEdit = new ElaLineEdit(this);
@@ -142,6 +138,6 @@ User RegistrationDialog::user() const
     u.passwordHash = Security::hashPassword(m_passwordEdit->text());
     u.role = UserRole::User;
     u.enabled = true;
-    u.balance = 0.0;
+    u.balance = Money();
     return u;
 }
@@ -6,6 +6,7 @@
 #include "ElaLineEdit.h"
 #include "ElaPushButton.h"
 #include "ElaText.h"
+#include "backend/Billing.h"
 #include "backend/Security.h"
 #include "ui/ThemeUtils.h"
 
@@ -51,16 +52,11 @@ void UserEditorDialog::setupUi()
     formLayout->addRow(createFormLabel(QStringLiteral(u"账号"), this), m_accountEdit);
 
     m_planCombo = new ElaComboBox(this);
-    const auto appendPlanOption = [](ElaComboBox *combo, Tariff plan, const QString &text)
+    for (const auto &plan : BillingEngine::tariffs().plans())
     {
-        combo->addItem(text, QVariant::fromValue(static_cast<int>(plan)));
-        combo->setItemData(combo->count() - 1, tariffBillingDescription(plan), Qt::ToolTipRole);
-    };
-    appendPlanOption(m_planCombo, Tariff::NoDiscount, QStringLiteral(u"标准计费"));
-    appendPlanOption(m_planCombo, Tariff::Pack30h, QStringLiteral(u"30 小时套餐"));
-    appendPlanOption(m_planCombo, Tariff::Pack60h, QStringLiteral(u"60 小时套餐"));
-    appendPlanOption(m_planCombo, Tariff::Pack150h, QStringLiteral(u"150 小时套餐"));
-    appendPlanOption(m_planCombo, Tariff::Unlimited, QStringLiteral(u"包月不限时"));
+        m_planCombo->addItem(plan.name, QVariant::fromValue(plan.id));
+        m_planCombo->setItemData(m_planCombo->count() - 1, plan.description, Qt::ToolTipRole);
+    }
 
     m_enabledCheck = new ElaCheckBox(QStringLiteral(u"启用此账号"), this);
     m_enabledCheck->setChecked(true);
@@ -145,7 +141,7 @@ void UserEditorDialog::setUser(const User &user)
 
     m_enabledCheck->setChecked(user.enabled);
     if (m_balanceEdit)
-        m_balanceEdit->setText(QString::number(user.balance, 'f', 2));
+        m_balanceEdit->setText(user.balance.toString());
     m_originalPasswordHash = user.passwordHash;
 }
 
@@ -157,11 +153,11 @@ User UserEditorDialog::user() const
     result.plan = static_cast<Tariff>(m_planCombo->currentData().toInt());
     result.role = m_adminCheck->isChecked() ? UserRole::Admin : UserRole::User;
     result.enabled = m_enabledCheck->isChecked();
-    double balance = 0.0;
+    Money balance;
     bool balanceOk = false;
     if (m_balanceEdit)
-        balance = m_balanceEdit->text().trimmed().toDouble(&balanceOk);
-    result.balance = balanceOk ? balance : 0.0;
+        balance = Money::parse(m_balanceEdit->text(), &balanceOk);
+    result.balance = balanceOk ? balance : Money();
 
     const QString newPassword = m_passwordEdit->text();
     if (!newPassword.isEmpty())
@@ -199,7 +195,7 @@ QString UserEditorDialog::validate() const
     if (m_balanceEdit)
     {
         bool balanceOk = false;
-        m_balanceEdit->text().trimmed().toDouble(&balanceOk);
+        Money::parse(m_balanceEdit->text(), &balanceOk);
         if (!balanceOk)
             return QStringLiteral(u"账户余额格式不正确。");
     }
@@ -1,5 +1,6 @@
 #include "ui/MainWindow.h"
 
+#include "backend/AsyncRepository.h"
 #include "backend/Billing.h"
 #include "backend/Repository.h"
 #include "backend/Security.h"
@@ -33,9 +34,11 @@
 #include <QFile>
 #include <QFileDialog>
 #include <QFileInfo>
+#include <QFutureWatcher>
 #include <QHash>
 #include <QIcon>
 #include <QMetaType>
+#include <QProgressDialog>
 #include <QRandomGenerator>
 #include <QSet>
 #include <QSignalBlocker>
@@ -84,6 +87,12 @@ namespace
     {
         return lhs.account == rhs.account && lhs.begin == rhs.begin && lhs.end == rhs.end;
     }
+
+    // 分区模式下驻留内存的最早月份：上一年 1 月起，更早的月份按需从分区读取
+    QDate residentSessionStart()
+    {
+        return QDate(QDate::currentDate().year() - 1, 1, 1);
+    }
 } // namespace
 
 MainWindow::MainWindow(const User &currentUser, QString dataDir, QString outputDir, QWidget *parent)
@@ -101,8 +110,9 @@ MainWindow::MainWindow(const User &currentUser, QString dataDir, QString outputD
     setupPreferences();
     connectSignals();
 
+    m_sessionCompactor.setMaxThreadCount(1);
     ensureOutputDir();
-    m_repository = std::make_unique<Repository>(m_dataDir, m_outputDir);
+    resetRepository();
 
     loadInitialData();
     setupForRole();
@@ -224,6 +234,7 @@ void MainWindow::connectSignals()
     {
         connect(m_billingPage.get(), &BillingPage::requestCompute, this, &MainWindow::handleComputeBilling);
         connect(m_billingPage.get(), &BillingPage::requestExport, this, &MainWindow::handleExportBilling);
+        connect(m_billingPage.get(), &BillingPage::requestArchiveExport, this, &MainWindow::handleExportArchivedBill);
         connect(m_billingPage.get(), &BillingPage::requestBrowseOutputDir, this, [this]
                 {
             const QString selected = QFileDialog::getExistingDirectory(this, QStringLiteral(u"选择导出目录"), m_outputDir);
@@ -233,7 +244,7 @@ void MainWindow::connectSignals()
             ensureOutputDir();
             if (m_billingPage)
                 m_billingPage->setOutputDirectory(m_outputDir);
-            m_repository = std::make_unique<Repository>(m_dataDir, m_outputDir);
+            resetRepository();
             resetComputedBills(); });
     }
 
@@ -242,6 +253,7 @@ void MainWindow::connectSignals()
     if (m_rechargePage)
     {
         connect(m_rechargePage.get(), &RechargePage::rechargeRequested, this, &MainWindow::handleRecharge);
+        connect(m_rechargePage.get(), &RechargePage::bulkRechargeRequested, this, &MainWindow::handleBulkRecharge);
     }
 
     if (m_settingsPage)
@@ -254,6 +266,7 @@ void MainWindow::connectSignals()
         connect(m_settingsPage.get(), &SettingsPage::switchAccountRequested, this, &MainWindow::handleSwitchAccountRequested);
         connect(m_settingsPage.get(), &SettingsPage::backupRequested, this, &MainWindow::handleBackupRequested);
         connect(m_settingsPage.get(), &SettingsPage::restoreRequested, this, &MainWindow::handleRestoreRequested);
+        connect(m_settingsPage.get(), &SettingsPage::partitionSessionsRequested, this, &MainWindow::handlePartitionSessionsRequested);
     }
 }
 
@@ -398,36 +411,57 @@ void MainWindow::persistUiSettings()
 
 void MainWindow::loadInitialData()
 {
+    QString tariffError;
+    BillingEngine::setTariffs(m_repository->loadTariffs(&tariffError));
+    if (!tariffError.isEmpty())
+        qWarning() << tariffError;
+    else if (!QFileInfo::exists(m_repository->tariffsPath()) && !m_repository->saveTariffs(BillingEngine::tariffs()))
+        qWarning() << "Failed to write tariffs.csv";
+
     m_users = m_repository->loadUsers();
+    m_pendingUserChanges.clear();
     std::sort(m_users.begin(), m_users.end(), userLess);
+    m_accounts.clear();
+    reindexUsers();
 
-    auto it = std::find_if(m_users.begin(), m_users.end(), [&](const User &user)
-                           { return user.account.compare(m_currentUser.account, Qt::CaseInsensitive) == 0; });
-    if (it == m_users.end())
+    int index = userIndexOf(m_currentUser.account);
+    if (index < 0)
     {
         m_users.push_back(m_currentUser);
         std::sort(m_users.begin(), m_users.end(), userLess);
-        it = std::find_if(m_users.begin(), m_users.end(), [&](const User &user)
-                          { return user.account.compare(m_currentUser.account, Qt::CaseInsensitive) == 0; });
+        reindexUsers();
+        index = userIndexOf(m_currentUser.account);
+        m_pendingUserChanges.push_back(UserChange{UserChange::Op::Upsert, m_currentUser});
         m_usersDirty = true;
     }
-    if (it != m_users.end())
+    if (index >= 0)
     {
-        m_currentUserIndex = static_cast<int>(std::distance(m_users.begin(), it));
-        m_currentUser = *it;
+        m_currentUserIndex = index;
+        m_currentUser = m_users[static_cast<std::size_t>(index)];
         m_currentBalance = m_currentUser.balance;
     }
 
-    m_sessions = m_repository->loadSessions();
+    if (m_repository->sessionsPartitioned() && !m_repository->migrateSessionsToPartitions())
+        qWarning() << "Failed to migrate sessions.csv into monthly partitions";
+    m_sessionWindowFrom = m_repository->sessionsPartitioned() ? residentSessionStart() : QDate();
+    m_sessions = m_sessionWindowFrom.isValid() ? m_repository->loadSessions(m_sessionWindowFrom) : m_repository->loadSessions();
+    m_pendingSessionChanges.clear();
     std::sort(m_sessions.begin(), m_sessions.end(), sessionLess);
     validateSessions();
+    for (auto &session : m_sessions)
+        session.accountId = m_accounts.intern(session.account);
+    m_usage.rebuild(m_sessions);
 
     m_recharges = m_repository->loadRechargeRecords();
+    for (auto &record : m_recharges)
+        record.accountId = m_accounts.intern(record.account);
     std::sort(m_recharges.begin(), m_recharges.end(), [](const RechargeRecord &a, const RechargeRecord &b)
               { return a.timestamp > b.timestamp; });
 
     if (m_billingPage)
         m_billingPage->setOutputDirectory(m_outputDir);
+    if (m_settingsPage)
+        m_settingsPage->setSessionsPartitioned(m_repository->sessionsPartitioned());
 
     updateAccountBanner();
 }
@@ -439,7 +473,10 @@ void MainWindow::validateSessions()
                                  {
         const bool broken = !session.begin.isValid() || !session.end.isValid() || session.end <= session.begin;
         if (broken)
+        {
             invalid.append(session);
+            m_pendingSessionChanges.push_back(SessionChange{SessionChange::Op::Remove, session});
+        }
         return broken; });
     if (newEnd == m_sessions.end())
         return;
@@ -508,7 +545,7 @@ void MainWindow::refreshBillingSummary()
     }
 
     int totalMinutes = 0;
-    double totalAmount = 0.0;
+    Money totalAmount;
     for (const auto &line : m_latestBills)
     {
         totalMinutes += line.minutes;
@@ -523,7 +560,7 @@ void MainWindow::refreshBillingSummary()
     else
     {
         int personalMinutes = 0;
-        double personalAmount = 0.0;
+        Money personalAmount;
         for (const auto &line : m_latestBills)
         {
             if (line.account.compare(m_currentUser.account, Qt::CaseInsensitive) == 0)
@@ -559,8 +596,9 @@ void MainWindow::refreshBillingSummary()
     if (m_reportsPage)
     {
         QVector<int> buckets(4, 0);
-        QVector<int> planCounts(5, 0);
-        QVector<double> planAmounts(5, 0.0);
+        const int planCount = BillingEngine::tariffs().planCount();
+        QVector<int> planCounts(planCount, 0);
+        QVector<Money> planAmounts(planCount);
         for (const auto &line : m_latestBills)
         {
             if (line.minutes <= 30 * 60)
@@ -572,7 +610,7 @@ void MainWindow::refreshBillingSummary()
             else
                 ++buckets[3];
 
-            const int planIndex = std::clamp(line.plan, 0, 4);
+            const int planIndex = (line.plan >= 0 && line.plan < planCount) ? line.plan : 0;
             ++planCounts[planIndex];
             planAmounts[planIndex] += line.amount;
         }
@@ -582,16 +620,16 @@ void MainWindow::refreshBillingSummary()
         m_reportsPage->setMonthlySummary(year, month, buckets, totalAmount, hasBillingData);
         m_reportsPage->setPlanDistribution(planCounts, planAmounts);
 
-        double rechargeIncome = 0.0;
-        double refundAmount = 0.0;
+        Money rechargeIncome;
+        Money refundAmount;
         for (const auto &record : m_recharges)
         {
-            if (record.amount >= 0)
+            if (record.amount >= Money())
                 rechargeIncome += record.amount;
             else
-                refundAmount += -record.amount;
+                refundAmount -= record.amount;
         }
-        const double netIncome = rechargeIncome - refundAmount;
+        const Money netIncome = rechargeIncome - refundAmount;
         m_reportsPage->setFinancialSummary(totalAmount, rechargeIncome, refundAmount, netIncome);
     }
 }
@@ -607,15 +645,14 @@ QVector<QPair<QString, double>> MainWindow::collectPersonalTrend(const QString &
     if (m_users.empty())
         return trend;
 
-    const auto userIt = std::find_if(m_users.begin(), m_users.end(), [&](const User &user)
-                                     { return user.account.compare(account, Qt::CaseInsensitive) == 0; });
-    if (userIt == m_users.end())
+    if (userIndexOf(account) < 0)
         return trend;
 
+    const AccountId accountId = m_accounts.find(account);
     QDate earliest;
     for (const auto &session : m_sessions)
     {
-        if (session.account.compare(account, Qt::CaseInsensitive) != 0)
+        if (session.accountId != accountId)
             continue;
 
         const QDate beginDate = session.begin.date();
@@ -630,7 +667,8 @@ QVector<QPair<QString, double>> MainWindow::collectPersonalTrend(const QString &
             earliest = endFirst;
     }
 
-    if (!earliest.isValid())
+    // 分区模式下更早的记录不在内存中，不能据此判断没有数据
+    if (!earliest.isValid() && !m_sessionWindowFrom.isValid())
         return trend;
 
     QDate anchor;
@@ -641,16 +679,29 @@ QVector<QPair<QString, double>> MainWindow::collectPersonalTrend(const QString &
     anchor = QDate(anchor.year(), anchor.month(), 1);
 
     QDate start = anchor.addMonths(-(kTrendWindowMonths - 1));
-    if (earliest.isValid() && earliest > start)
+    if (earliest.isValid() && earliest > start && !m_sessionWindowFrom.isValid())
         start = earliest;
 
-    for (QDate month = start; month <= anchor; month = month.addMonths(1))
+    // 趋势窗口早于驻留范围时，之前的月份只读取对应分区，之后的仍以内存中的记录为准
+    const std::vector<Session> *sessions = &m_sessions;
+    std::vector<Session> combined;
+    if (m_sessionWindowFrom.isValid() && start < m_sessionWindowFrom && m_repository)
     {
-        const auto bills = BillingEngine::computeMonthly(month.year(), month.month(), m_users, m_sessions);
-        const auto it = std::find_if(bills.begin(), bills.end(), [&](const BillLine &line)
-                                     { return line.account.compare(account, Qt::CaseInsensitive) == 0; });
-        const double amount = (it != bills.end()) ? it->amount : 0.0;
-        trend.append({month.toString(QStringLiteral("yyyy-MM")), amount});
+        combined = m_repository->loadSessions(start, m_sessionWindowFrom.addMonths(-1));
+        for (const auto &session : m_sessions)
+        {
+            if (sessionEditable(session))
+                combined.push_back(session);
+        }
+        sessions = &combined;
+    }
+
+    const BillMatrix bills = BillingEngine::computeRange(start, anchor, m_users, *sessions);
+    const int column = bills.columnOf(account, Qt::CaseInsensitive);
+    for (int row = 0; row < bills.monthCount(); ++row)
+    {
+        const double amount = column >= 0 ? bills.at(row, column).amount.toYuan() : 0.0;
+        trend.append({bills.months[static_cast<std::size_t>(row)].toString(QStringLiteral("yyyy-MM")), amount});
     }
 
     while (!trend.isEmpty() && qFuzzyIsNull(trend.constFirst().second))
@@ -681,9 +732,10 @@ void MainWindow::refreshRechargePage()
     }
     else
     {
+        const AccountId currentId = m_accounts.find(m_currentUser.account);
         std::vector<RechargeRecord> mine;
         std::copy_if(m_recharges.begin(), m_recharges.end(), std::back_inserter(mine), [&](const RechargeRecord &record)
-                     { return record.account.compare(m_currentUser.account, Qt::CaseInsensitive) == 0; });
+                     { return record.accountId == currentId; });
         m_rechargePage->setRechargeRecords(mine);
     }
 }
@@ -697,6 +749,33 @@ void MainWindow::resetComputedBills()
     m_lastBillingInfo.clear();
 }
 
+void MainWindow::reindexUsers()
+{
+    std::vector<AccountId> ids;
+    ids.reserve(m_users.size());
+    for (const auto &user : m_users)
+        ids.push_back(m_accounts.intern(user.account));
+
+    // 倒序写入，大小写重复的账号以排序后靠前者为准
+    m_userSlots.assign(m_accounts.size(), -1);
+    for (std::size_t i = ids.size(); i-- > 0;)
+        m_userSlots[ids[i]] = static_cast<int>(i);
+}
+
+int MainWindow::userIndexOf(const QString &account) const
+{
+    const AccountId id = m_accounts.find(account);
+    if (id == kInvalidAccountId || id >= m_userSlots.size())
+        return -1;
+    return m_userSlots[id];
+}
+
+User *MainWindow::findUser(const QString &account)
+{
+    const int index = userIndexOf(account);
+    return index < 0 ? nullptr : &m_users[static_cast<std::size_t>(index)];
+}
+
 void MainWindow::handleCreateUser()
 {
     if (!m_isAdmin || !m_usersPage)
@@ -715,9 +794,7 @@ void MainWindow::handleCreateUser()
     if (user.account.trimmed().isEmpty())
         return;
 
-    const bool exists = std::any_of(m_users.begin(), m_users.end(), [&](const User &u)
-                                    { return u.account.compare(user.account, Qt::CaseInsensitive) == 0; });
-    if (exists)
+    if (userIndexOf(user.account) >= 0)
     {
         showThemedWarning(this, windowTitle(), QStringLiteral(u"账号已存在，请使用唯一账号。"));
         return;
@@ -725,6 +802,8 @@ void MainWindow::handleCreateUser()
 
     m_users.push_back(user);
     std::sort(m_users.begin(), m_users.end(), userLess);
+    reindexUsers();
+    m_pendingUserChanges.push_back(UserChange{UserChange::Op::Upsert, user});
     m_usersDirty = true;
     refreshUsersPage();
 }
@@ -734,9 +813,8 @@ void MainWindow::handleEditUser(const QString &account)
     if (!m_isAdmin || !m_usersPage)
         return;
 
-    auto it = std::find_if(m_users.begin(), m_users.end(), [&](const User &u)
-                           { return u.account.compare(account, Qt::CaseInsensitive) == 0; });
-    if (it == m_users.end())
+    User *it = findUser(account);
+    if (!it)
     {
         showThemedWarning(this, windowTitle(), QStringLiteral(u"未找到选中的账号。"));
         return;
@@ -756,7 +834,15 @@ void MainWindow::handleEditUser(const QString &account)
     if (dialog.exec() != QDialog::Accepted)
         return;
 
+    // 改名后旧账号的会话要随之处理，重新加载上网记录期间不允许
+    if (dialog.user().account != it->account && sessionsLoadPending())
+        return;
+
+    const QString previousAccount = it->account;
     *it = dialog.user();
+    if (previousAccount != it->account)
+        m_pendingUserChanges.push_back(UserChange{UserChange::Op::Remove, User{QString(), previousAccount}});
+    m_pendingUserChanges.push_back(UserChange{UserChange::Op::Upsert, *it});
     if (m_currentUser.account.compare(it->account, Qt::CaseInsensitive) == 0)
     {
         m_currentUser = *it;
@@ -764,6 +850,7 @@ void MainWindow::handleEditUser(const QString &account)
         updateAccountBanner();
     }
     std::sort(m_users.begin(), m_users.end(), userLess);
+    reindexUsers();
     m_usersDirty = true;
     refreshUsersPage();
     refreshBillingSummary();
@@ -775,6 +862,9 @@ void MainWindow::handleDeleteUsers(const QStringList &accounts)
     if (!m_isAdmin || !m_usersPage || accounts.isEmpty())
         return;
 
+    if (sessionsLoadPending())
+        return;
+
     for (const QString &account : accounts)
     {
         if (account.compare(m_currentUser.account, Qt::CaseInsensitive) == 0)
@@ -796,12 +886,22 @@ void MainWindow::handleDeleteUsers(const QStringList &accounts)
         targets.insert(account.toLower());
 
     m_users.erase(std::remove_if(m_users.begin(), m_users.end(), [&](const User &user)
-                                 { return targets.contains(user.account.toLower()); }),
+                                 {
+                                     if (!targets.contains(user.account.toLower()))
+                                         return false;
+                                     m_pendingUserChanges.push_back(UserChange{UserChange::Op::Remove, user});
+                                     return true; }),
                   m_users.end());
 
     const auto sessionsSizeBefore = m_sessions.size();
     m_sessions.erase(std::remove_if(m_sessions.begin(), m_sessions.end(), [&](const Session &session)
-                                    { return targets.contains(session.account.toLower()); }),
+                                    {
+                                        // 早于驻留范围开始的记录在历史分区中，不随用户一起删除
+                                        if (!targets.contains(session.account.toLower()) || !sessionEditable(session))
+                                            return false;
+                                        m_usage.removeSession(session);
+                                        m_pendingSessionChanges.push_back(SessionChange{SessionChange::Op::Remove, session});
+                                        return true; }),
                      m_sessions.end());
     if (m_sessions.size() != sessionsSizeBefore)
         m_sessionsDirty = true;
@@ -810,13 +910,13 @@ void MainWindow::handleDeleteUsers(const QStringList &accounts)
     refreshUsersPage();
     refreshSessionsPage();
 
-    auto currentIt = std::find_if(m_users.begin(), m_users.end(), [&](const User &user)
-                                  { return user.account.compare(m_currentUser.account, Qt::CaseInsensitive) == 0; });
-    if (currentIt != m_users.end())
+    reindexUsers();
+    const int currentIndex = userIndexOf(m_currentUser.account);
+    if (currentIndex >= 0)
     {
-        m_currentUserIndex = static_cast<int>(std::distance(m_users.begin(), currentIt));
-        m_currentUser = *currentIt;
-        m_currentBalance = currentIt->balance;
+        m_currentUserIndex = currentIndex;
+        m_currentUser = m_users[static_cast<std::size_t>(currentIndex)];
+        m_currentBalance = m_currentUser.balance;
         updateAccountBanner();
     }
 }
@@ -826,6 +926,9 @@ void MainWindow::handleReloadUsers()
     if (!m_isAdmin || !m_usersPage)
         return;
 
+    if (sessionsLoadPending())
+        return;
+
     if (m_usersDirty)
     {
         if (showThemedQuestion(this,
@@ -861,6 +964,9 @@ void MainWindow::handleCreateSession()
     if (!m_isAdmin || !m_sessionsPage)
         return;
 
+    if (sessionsLoadPending())
+        return;
+
     QHash<QString, QString> names;
     for (const auto &user : m_users)
         names.insert(user.account, user.name);
@@ -872,8 +978,17 @@ void MainWindow::handleCreateSession()
     Session session = dialog.session();
     if (session.account.isEmpty())
         return;
+    if (!sessionEditable(session))
+    {
+        showThemedWarning(this, windowTitle(),
+                          QStringLiteral(u"只能添加 %1 起开始的上网记录。").arg(m_sessionWindowFrom.toString(QStringLiteral("yyyy-MM"))));
+        return;
+    }
 
+    session.accountId = m_accounts.intern(session.account);
     m_sessions.push_back(session);
+    m_usage.addSession(session);
+    m_pendingSessionChanges.push_back(SessionChange{SessionChange::Op::Insert, session});
     std::sort(m_sessions.begin(), m_sessions.end(), sessionLess);
     m_sessionsDirty = true;
     refreshSessionsPage();
@@ -885,6 +1000,9 @@ void MainWindow::handleEditSession(const Session &session)
     if (!m_isAdmin || !m_sessionsPage)
         return;
 
+    if (sessionsLoadPending())
+        return;
+
     auto it = std::find_if(m_sessions.begin(), m_sessions.end(), [&](const Session &s)
                            { return sessionsEqual(s, session); });
     if (it == m_sessions.end())
@@ -892,6 +1010,13 @@ void MainWindow::handleEditSession(const Session &session)
         showThemedWarning(this, windowTitle(), QStringLiteral(u"未找到选中的上网记录。"));
         return;
     }
+    const QString windowMessage = QStringLiteral(u"%1 之前开始的上网记录保存在历史分区中，不能在此修改。")
+                                      .arg(m_sessionWindowFrom.toString(QStringLiteral("yyyy-MM")));
+    if (!sessionEditable(*it))
+    {
+        showThemedWarning(this, windowTitle(), windowMessage);
+        return;
+    }
 
     QHash<QString, QString> names;
     for (const auto &user : m_users)
@@ -901,8 +1026,18 @@ void MainWindow::handleEditSession(const Session &session)
     dialog.setSession(*it);
     if (dialog.exec() != QDialog::Accepted)
         return;
+    if (!sessionEditable(dialog.session()))
+    {
+        showThemedWarning(this, windowTitle(), windowMessage);
+        return;
+    }
 
+    m_usage.removeSession(*it);
+    m_pendingSessionChanges.push_back(SessionChange{SessionChange::Op::Remove, *it});
     *it = dialog.session();
+    it->accountId = m_accounts.intern(it->account);
+    m_usage.addSession(*it);
+    m_pendingSessionChanges.push_back(SessionChange{SessionChange::Op::Insert, *it});
     std::sort(m_sessions.begin(), m_sessions.end(), sessionLess);
     m_sessionsDirty = true;
     refreshSessionsPage();
@@ -914,6 +1049,20 @@ void MainWindow::handleDeleteSessions(const QList<Session> &sessions)
     if (!m_isAdmin || !m_sessionsPage || sessions.isEmpty())
         return;
 
+    if (sessionsLoadPending())
+        return;
+
+    for (const auto &session : sessions)
+    {
+        if (!sessionEditable(session))
+        {
+            showThemedWarning(this, windowTitle(),
+                              QStringLiteral(u"%1 之前开始的上网记录保存在历史分区中，不能在此删除。")
+                                  .arg(m_sessionWindowFrom.toString(QStringLiteral("yyyy-MM"))));
+            return;
+        }
+    }
+
     if (showThemedQuestion(this,
                            windowTitle(),
                            QStringLiteral(u"确认要删除选中的 %1 条上网记录吗？").arg(sessions.size()),
@@ -926,7 +1075,12 @@ void MainWindow::handleDeleteSessions(const QList<Session> &sessions)
         m_sessions.erase(std::remove_if(m_sessions.begin(),
                                         m_sessions.end(),
                                         [&](const Session &s)
-                                        { return sessionsEqual(s, session); }),
+                                        {
+                                            if (!sessionsEqual(s, session))
+                                                return false;
+                                            m_usage.removeSession(s);
+                                            m_pendingSessionChanges.push_back(SessionChange{SessionChange::Op::Remove, s});
+                                            return true; }),
                          m_sessions.end());
     }
     m_sessionsDirty = true;
@@ -936,7 +1090,7 @@ void MainWindow::handleDeleteSessions(const QList<Session> &sessions)
 
 void MainWindow::handleReloadSessions()
 {
-    if (!m_sessionsPage)
+    if (!m_sessionsPage || m_sessionsLoading)
         return;
 
     if (m_sessionsDirty)
@@ -949,15 +1103,44 @@ void MainWindow::handleReloadSessions()
             return;
     }
 
-    m_sessions = m_repository->loadSessions();
+    // 压缩写完新的基础文件后再读，避免读到一半时基础文件与日志被替换
+    m_sessionCompactor.waitForDone();
+
+    // 读取与解析在后台进行，完成前禁用页面，其他修改会话的操作也由 sessionsLoadPending 拦下，
+    // 以免完成时加载结果覆盖这段时间内的修改
+    m_sessionsLoading = true;
+    m_sessionsPage->setEnabled(false);
+    auto *watcher = new QFutureWatcher<std::vector<Session>>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher]()
+            {
+        watcher->deleteLater();
+        m_sessionsLoading = false;
+        if (m_sessionsPage)
+            m_sessionsPage->setEnabled(true);
+        if (watcher->isCanceled() || watcher->future().resultCount() == 0)
+            return;
+
+        adoptLoadedSessions(watcher->future().takeResult());
+        refreshSessionsPage();
+        resetComputedBills(); });
+    watcher->setFuture(m_asyncRepository->loadSessions(m_sessionWindowFrom));
+}
+
+void MainWindow::adoptLoadedSessions(std::vector<Session> sessions)
+{
+    m_sessions = std::move(sessions);
+    m_pendingSessionChanges.clear();
     std::sort(m_sessions.begin(), m_sessions.end(), sessionLess);
+    for (auto &session : m_sessions)
+        session.accountId = m_accounts.intern(session.account);
+    m_usage.rebuild(m_sessions);
     m_sessionsDirty = false;
-    refreshSessionsPage();
-    resetComputedBills();
 }
 
 void MainWindow::handleSaveSessions()
 {
+    if (sessionsLoadPending())
+        return;
     if (!persistSessions())
     {
         showThemedWarning(this, windowTitle(), QStringLiteral(u"保存上网记录失败。"));
@@ -971,6 +1154,9 @@ void MainWindow::handleGenerateRandomSessions()
     if (!m_isAdmin || !m_sessionsPage)
         return;
 
+    if (sessionsLoadPending())
+        return;
+
     if (m_users.empty())
     {
         showThemedWarning(this, windowTitle(), QStringLiteral(u"请先创建至少一位用户。"));
@@ -988,7 +1174,9 @@ void MainWindow::handleGenerateRandomSessions()
         const QDateTime end = begin.addSecs(minutes * 60);
         if (end <= begin)
             return;
-        m_sessions.push_back(Session{account, begin, end});
+        m_sessions.push_back(Session{account, begin, end, m_accounts.intern(account)});
+        m_usage.addSession(m_sessions.back());
+        m_pendingSessionChanges.push_back(SessionChange{SessionChange::Op::Insert, m_sessions.back()});
     };
 
     for (const auto &user : m_users)
@@ -1049,9 +1237,8 @@ void MainWindow::handleChangePasswordRequest()
         return;
     }
 
-    auto it = std::find_if(m_users.begin(), m_users.end(), [&](const User &user)
-                           { return user.account.compare(account, Qt::CaseInsensitive) == 0; });
-    if (it == m_users.end())
+    User *it = findUser(account);
+    if (!it)
     {
         showThemedWarning(this, windowTitle(), QStringLiteral(u"账号不存在。"));
         return;
@@ -1066,13 +1253,13 @@ void MainWindow::handleChangePasswordRequest()
     const QString oldHash = it->passwordHash;
     it->passwordHash = Security::hashPassword(dialog.newPassword());
 
-    // Update in-memory current user first so persistUsers writes the correct hash
+    // Update in-memory current user first so later checkpoints write the correct hash
     if (m_currentUser.account.compare(account, Qt::CaseInsensitive) == 0)
     {
         m_currentUser.passwordHash = it->passwordHash;
     }
 
-    if (!persistUsers())
+    if (!m_repository || !m_repository->commitUserChanges({UserChange{UserChange::Op::Upsert, *it}}))
     {
         it->passwordHash = oldHash;
         // restore current user hash as well
@@ -1124,6 +1311,9 @@ void MainWindow::handleBackupRequested()
     if (!m_isAdmin || !m_repository)
         return;
 
+    if (sessionsLoadPending())
+        return;
+
     if (m_usersDirty && !persistUsers())
     {
         showThemedWarning(this, windowTitle(), QStringLiteral(u"保存用户数据失败，已取消备份。"));
@@ -1136,34 +1326,89 @@ void MainWindow::handleBackupRequested()
         return;
     }
 
+    m_asyncRepository->waitForDone();
     if (!m_repository->saveRechargeRecords(m_recharges))
     {
         showThemedWarning(this, windowTitle(), QStringLiteral(u"写入充值流水失败，已取消备份。"));
         return;
     }
+    m_sessionCompactor.waitForDone();
 
     const QString defaultName = QStringLiteral("NetBilling-%1.nbbak").arg(QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd-HHmmss")));
+    const QString compressedFilter = QStringLiteral(u"NetBilling 压缩备份 (*.nbbak)");
+    const QString plainFilter = QStringLiteral(u"NetBilling 备份（不压缩） (*.nbbak)");
+    QString selectedFilter = compressedFilter;
     QString target = QFileDialog::getSaveFileName(this,
                                                   QStringLiteral(u"导出数据备份"),
                                                   defaultName,
-                                                  QStringLiteral(u"NetBilling 备份 (*.nbbak);;所有文件 (*.*)"));
+                                                  QStringLiteral("%1;;%2;;%3").arg(compressedFilter, plainFilter, QStringLiteral(u"所有文件 (*.*)")),
+                                                  &selectedFilter);
     if (target.isEmpty())
         return;
+    const int compressionLevel = selectedFilter == plainFilter ? 0 : m_settingsPage->backupCompressionLevel();
 
     if (QFileInfo(target).suffix().isEmpty())
         target.append(QStringLiteral(".nbbak"));
 
-    QString error;
-    if (!m_repository->exportBackup(target, &error))
+    // 同一目录下已有带清单的备份时可只备份变化的部分，以最近的一份为基准；
+    // 旧版本或不完整的备份不能作基准，跳过后没有可用基准就做全量备份
+    QString basePath;
+    const QFileInfoList previous = QFileInfo(target).absoluteDir().entryInfoList({QStringLiteral("*.nbbak")}, QDir::Files, QDir::Time);
+    for (const QFileInfo &info : previous)
     {
-        if (error.isEmpty())
-            error = QStringLiteral(u"导出备份失败。");
-        showThemedWarning(this, windowTitle(), error);
-        return;
+        if (info.absoluteFilePath() != QFileInfo(target).absoluteFilePath() && Repository::isIncrementalBase(info.absoluteFilePath()))
+        {
+            basePath = info.absoluteFilePath();
+            break;
+        }
     }
+    if (!basePath.isEmpty()
+        && showThemedQuestion(this, windowTitle(),
+                              QStringLiteral(u"是否以 %1 为基准做增量备份？\n增量备份只保存变化的内容，恢复时需要基准备份在同一目录中。")
+                                  .arg(QFileInfo(basePath).fileName()),
+                              QMessageBox::Yes | QMessageBox::No, QMessageBox::Yes) != QMessageBox::Yes)
+        basePath.clear();
+
+    // 导出在后台进行，进度以 KiB 为单位；取消后未写完的文件不会落盘
+    auto *progressDialog = new QProgressDialog(QStringLiteral(u"正在导出数据备份…"), QStringLiteral(u"取消"), 0, 0, this);
+    progressDialog->setWindowTitle(windowTitle());
+    progressDialog->setWindowModality(Qt::WindowModal);
+    progressDialog->setMinimumDuration(300);
+    progressDialog->setAutoClose(false);
+    progressDialog->setAutoReset(false);
+
+    auto *watcher = new QFutureWatcher<RepositoryResult>(this);
+    connect(watcher, &QFutureWatcherBase::progressRangeChanged, progressDialog, &QProgressDialog::setRange);
+    connect(watcher, &QFutureWatcherBase::progressValueChanged, progressDialog, &QProgressDialog::setValue);
+    connect(progressDialog, &QProgressDialog::canceled, watcher, &QFutureWatcherBase::cancel);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, progressDialog, target]()
+            {
+        watcher->deleteLater();
+        progressDialog->deleteLater();
+        if (watcher->isCanceled() || watcher->future().resultCount() == 0)
+        {
+            showThemedInformation(this, windowTitle(), QStringLiteral(u"备份已取消。"));
+            return;
+        }
 
-    showThemedInformation(this, windowTitle(),
-                          QStringLiteral(u"数据备份已导出至：\n%1").arg(QDir::toNativeSeparators(target)));
+        RepositoryResult result = watcher->result();
+        if (!result.ok)
+        {
+            if (result.error.isEmpty())
+                result.error = QStringLiteral(u"导出备份失败。");
+            showThemedWarning(this, windowTitle(), result.error);
+            return;
+        }
+
+        // rawBytes 只统计本次新写入的块，增量备份中引用基准的块不计入
+        const BackupStats &stats = result.stats;
+        showThemedInformation(this, windowTitle(),
+                              QStringLiteral(u"数据备份已导出至：\n%1\n新写入数据 %2 MB（压缩前），压缩比 %3 : 1，%4 MB/s")
+                                  .arg(QDir::toNativeSeparators(target))
+                                  .arg(static_cast<double>(stats.rawBytes) / (1024.0 * 1024.0), 0, 'f', 1)
+                                  .arg(stats.ratio(), 0, 'f', 1)
+                                  .arg(stats.megabytesPerSecond(), 0, 'f', 1)); });
+    watcher->setFuture(m_asyncRepository->exportBackup(target, basePath, compressionLevel));
 }
 
 void MainWindow::handleRestoreRequested()
@@ -1171,6 +1416,9 @@ void MainWindow::handleRestoreRequested()
     if (!m_isAdmin || !m_repository)
         return;
 
+    if (sessionsLoadPending())
+        return;
+
     const bool hasUnsaved = m_usersDirty || m_sessionsDirty;
     const QString prompt = hasUnsaved
                                ? QStringLiteral(u"检测到存在尚未保存的修改，恢复备份将覆盖当前数据。\n确定继续吗？")
@@ -1186,6 +1434,8 @@ void MainWindow::handleRestoreRequested()
     if (source.isEmpty())
         return;
 
+    m_sessionCompactor.waitForDone();
+    m_asyncRepository->waitForDone();
     QString error;
     if (!m_repository->importBackup(source, &error))
     {
@@ -1204,10 +1454,49 @@ void MainWindow::handleRestoreRequested()
     resetComputedBills();
     refreshBillingSummary();
     refreshRechargePage();
+    // 恢复的数据已重新加载，被替换的旧文件不再需要
+    m_repository->discardReplacedData();
 
     showThemedInformation(this, windowTitle(), QStringLiteral(u"数据已从备份中恢复。"));
 }
 
+void MainWindow::handlePartitionSessionsRequested()
+{
+    if (!m_isAdmin || !m_repository || m_repository->sessionsPartitioned())
+        return;
+
+    if (sessionsLoadPending())
+        return;
+
+    if (showThemedQuestion(this, windowTitle(),
+                           QStringLiteral(u"上网记录将按月份分文件保存，之后只加载 %1 起的记录，更早的记录只能查询、不能修改。\n确定转换吗？")
+                               .arg(residentSessionStart().toString(QStringLiteral("yyyy-MM"))),
+                           QMessageBox::Yes | QMessageBox::No, QMessageBox::No) != QMessageBox::Yes)
+        return;
+
+    if (m_sessionsDirty && !persistSessions())
+    {
+        showThemedWarning(this, windowTitle(), QStringLiteral(u"保存上网记录失败，已取消转换。"));
+        return;
+    }
+    m_sessionCompactor.waitForDone();
+    m_asyncRepository->waitForDone();
+    if (!m_repository->enableSessionPartitions())
+    {
+        showThemedWarning(this, windowTitle(), QStringLiteral(u"转换为按月分区存储失败，请检查数据目录权限。"));
+        return;
+    }
+
+    m_sessionWindowFrom = residentSessionStart();
+    adoptLoadedSessions(m_repository->loadSessions(m_sessionWindowFrom));
+    if (m_settingsPage)
+        m_settingsPage->setSessionsPartitioned(true);
+    refreshSessionsPage();
+    resetComputedBills();
+    refreshBillingSummary();
+    showThemedInformation(this, windowTitle(), QStringLiteral(u"上网记录已按月分区存储。"));
+}
+
 void MainWindow::handleStackIndexChanged()
 {
     if (!m_isAdmin || !m_billingPage)
@@ -1233,9 +1522,17 @@ void MainWindow::handleComputeBilling()
     const int year = m_billingPage->selectedYear();
     const int month = m_billingPage->selectedMonth();
 
+#ifdef QT_DEBUG
+    if (!m_usage.matches(m_sessions))
+    {
+        qWarning() << "Usage aggregates diverged from sessions, rebuilding";
+        m_usage.rebuild(m_sessions);
+    }
+#endif
+
     if (!m_isAdmin)
     {
-        const auto allBills = BillingEngine::computeMonthly(year, month, m_users, m_sessions);
+        const auto allBills = computeBills(year, month);
         std::vector<BillLine> mine;
         std::copy_if(allBills.begin(), allBills.end(), std::back_inserter(mine), [&](const BillLine &line)
                      { return line.account.compare(m_currentUser.account, Qt::CaseInsensitive) == 0; });
@@ -1246,7 +1543,7 @@ void MainWindow::handleComputeBilling()
         m_lastBillMonth = month;
 
         const QLocale locale(QLocale::Chinese, QLocale::China);
-        double totalAmount = 0.0;
+        Money totalAmount;
         for (const auto &line : mine)
             totalAmount += line.amount;
 
@@ -1255,7 +1552,7 @@ void MainWindow::handleComputeBilling()
             m_lastBillingInfo = QStringLiteral(u"最新账单：%1 年 %2 月合计 %3 元")
                                     .arg(year)
                                     .arg(month, 2, 10, QLatin1Char('0'))
-                                    .arg(locale.toString(totalAmount, 'f', 2));
+                                    .arg(locale.toString(totalAmount.toYuan(), 'f', 2));
         }
         else
         {
@@ -1276,46 +1573,47 @@ void MainWindow::handleComputeBilling()
     {
         m_outputDir = dirFromUi;
         ensureOutputDir();
-        m_repository = std::make_unique<Repository>(m_dataDir, m_outputDir);
+        resetRepository();
         if (m_billingPage)
             m_billingPage->setOutputDirectory(m_outputDir);
     }
 
-    m_latestBills = BillingEngine::computeMonthly(year, month, m_users, m_sessions);
+    m_latestBills = computeBills(year, month);
     m_hasComputed = true;
     m_lastBillYear = year;
     m_lastBillMonth = month;
 
     QVector<QString> negativeAccounts;
     const QDateTime timestamp = QDateTime::currentDateTime();
-    double totalAmount = 0.0;
+    Money totalAmount;
+    std::vector<UserChange> balanceChanges;
+    balanceChanges.reserve(m_latestBills.size());
 
     for (auto &line : m_latestBills)
     {
         totalAmount += line.amount;
 
-        auto it = std::find_if(m_users.begin(), m_users.end(), [&](const User &user)
-                               { return user.account.compare(line.account, Qt::CaseInsensitive) == 0; });
-        if (it == m_users.end())
+        User *it = findUser(line.account);
+        if (!it)
             continue;
 
         it->balance -= line.amount;
-        if (it->balance < 0)
+        if (it->balance < Money())
             negativeAccounts.append(it->account);
+        balanceChanges.push_back(UserChange{UserChange::Op::Balance, *it});
 
-        RechargeRecord deduction{line.account, timestamp, -line.amount, m_currentUser.account, QStringLiteral(u"月度扣费"), it->balance};
+        RechargeRecord deduction{line.account, timestamp, -line.amount, m_currentUser.account, QStringLiteral(u"月度扣费"), it->balance, m_accounts.intern(line.account)};
         m_recharges.insert(m_recharges.begin(), deduction);
     }
 
     auto refreshCurrent = [&]()
     {
-        auto currentIt = std::find_if(m_users.begin(), m_users.end(), [&](const User &user)
-                                      { return user.account.compare(m_currentUser.account, Qt::CaseInsensitive) == 0; });
-        if (currentIt != m_users.end())
+        const int currentIndex = userIndexOf(m_currentUser.account);
+        if (currentIndex >= 0)
         {
-            m_currentUserIndex = static_cast<int>(std::distance(m_users.begin(), currentIt));
-            m_currentUser = *currentIt;
-            m_currentBalance = currentIt->balance;
+            m_currentUserIndex = currentIndex;
+            m_currentUser = m_users[static_cast<std::size_t>(currentIndex)];
+            m_currentBalance = m_currentUser.balance;
             updateAccountBanner();
         }
     };
@@ -1324,18 +1622,17 @@ void MainWindow::handleComputeBilling()
     m_lastBillingInfo = QStringLiteral(u"最新账单：%1 年 %2 月合计 %3 元")
                             .arg(year)
                             .arg(month, 2, 10, QLatin1Char('0'))
-                            .arg(QString::number(totalAmount, 'f', 2));
+                            .arg(totalAmount.toString());
 
-    if (!persistUsers())
+    // 所有账号的扣费合并为一次日志写入
+    if (!m_repository->commitUserChanges(balanceChanges))
         showThemedWarning(this, windowTitle(), QStringLiteral(u"保存用户余额失败，请稍后重试。"));
+    else
+        checkpointUsersIfNeeded();
 
-    if (m_repository && !m_repository->saveRechargeRecords(m_recharges))
-        showThemedWarning(this, windowTitle(), QStringLiteral(u"写入充值流水失败，请检查数据目录权限。"));
-
-    if (m_repository && !m_repository->writeMonthlyBill(year, month, m_latestBills))
-    {
-        showThemedWarning(this, windowTitle(), QStringLiteral(u"账单写入失败，请检查输出目录。"));
-    }
+    // 流水与账单文件在后台写入，失败时再回到界面线程提示
+    warnOnFailure(m_asyncRepository->saveRechargeRecords(m_recharges));
+    warnOnFailure(m_asyncRepository->writeMonthlyBill(year, month, m_latestBills));
 
     if (!negativeAccounts.isEmpty())
     {
@@ -1363,42 +1660,96 @@ void MainWindow::handleExportBilling()
     {
         m_outputDir = dirFromUi;
         ensureOutputDir();
-        m_repository = std::make_unique<Repository>(m_dataDir, m_outputDir);
+        resetRepository();
         if (m_billingPage)
             m_billingPage->setOutputDirectory(m_outputDir);
     }
 
     ensureOutputDir();
-    if (m_repository->writeMonthlyBill(m_lastBillYear, m_lastBillMonth, m_latestBills))
-    {
-        const QString fileName = QStringLiteral("%1/bill_%2_%3.csv")
-                                     .arg(m_outputDir)
-                                     .arg(m_lastBillYear)
-                                     .arg(m_lastBillMonth, 2, 10, QLatin1Char('0'));
+    const QString fileName = QStringLiteral("%1/bill_%2_%3.csv")
+                                 .arg(m_outputDir)
+                                 .arg(m_lastBillYear)
+                                 .arg(m_lastBillMonth, 2, 10, QLatin1Char('0'));
+    auto *watcher = new QFutureWatcher<RepositoryResult>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, fileName]()
+            {
+        watcher->deleteLater();
+        if (watcher->isCanceled() || watcher->future().resultCount() == 0)
+            return;
+        const RepositoryResult result = watcher->result();
+        if (!result.ok)
+        {
+            showThemedWarning(this, windowTitle(), result.error);
+            return;
+        }
         showThemedInformation(this, windowTitle(),
                               QStringLiteral(u"账单已导出至：\n%1")
-                                  .arg(QDir::toNativeSeparators(fileName)));
+                                  .arg(QDir::toNativeSeparators(fileName))); });
+    watcher->setFuture(m_asyncRepository->writeMonthlyBill(m_lastBillYear, m_lastBillMonth, m_latestBills));
+}
+
+void MainWindow::handleExportArchivedBill()
+{
+    if (!m_isAdmin || !m_repository || !m_billingPage)
+        return;
+
+    if (sessionsLoadPending())
+        return;
+
+    // 汇总直接读取磁盘上的会话文件，未保存的修改要先落盘
+    if (m_sessionsDirty && !persistSessions())
+    {
+        showThemedWarning(this, windowTitle(), QStringLiteral(u"保存上网记录失败，已取消导出。"));
+        return;
     }
-    else
+
+    const QString dirFromUi = m_billingPage->outputDirectory();
+    if (!dirFromUi.isEmpty() && dirFromUi != m_outputDir)
     {
-        showThemedWarning(this, windowTitle(), QStringLiteral(u"写入账单文件失败，请检查目录权限。"));
+        m_outputDir = dirFromUi;
+        ensureOutputDir();
+        resetRepository();
+        m_billingPage->setOutputDirectory(m_outputDir);
     }
+    ensureOutputDir();
+
+    const int year = m_billingPage->selectedYear();
+    const int month = m_billingPage->selectedMonth();
+    const QString fileName = QStringLiteral("%1/bill_%2_%3.csv")
+                                 .arg(m_outputDir)
+                                 .arg(year)
+                                 .arg(month, 2, 10, QLatin1Char('0'));
+    auto *watcher = new QFutureWatcher<RepositoryResult>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, fileName]()
+            {
+        watcher->deleteLater();
+        if (watcher->isCanceled() || watcher->future().resultCount() == 0)
+            return;
+        const RepositoryResult result = watcher->result();
+        if (!result.ok)
+        {
+            showThemedWarning(this, windowTitle(), result.error);
+            return;
+        }
+        showThemedInformation(this, windowTitle(),
+                              QStringLiteral(u"账单已由存档汇总并导出至：\n%1")
+                                  .arg(QDir::toNativeSeparators(fileName))); });
+    watcher->setFuture(m_asyncRepository->exportArchivedBill(year, month, m_users));
 }
 
-void MainWindow::handleRecharge(const QString &account, double amount, const QString &note, bool selfService)
+void MainWindow::handleRecharge(const QString &account, Money amount, const QString &note, bool selfService)
 {
     if (account.isEmpty())
         return;
 
-    if (selfService && amount <= 0)
+    if (selfService && amount <= Money())
     {
         showThemedWarning(this, windowTitle(), QStringLiteral(u"充值金额必须大于 0。"));
         return;
     }
 
-    auto it = std::find_if(m_users.begin(), m_users.end(), [&](const User &user)
-                           { return user.account.compare(account, Qt::CaseInsensitive) == 0; });
-    if (it == m_users.end())
+    User *it = findUser(account);
+    if (!it)
     {
         showThemedWarning(this, windowTitle(), QStringLiteral(u"账号不存在。"));
         return;
@@ -1417,24 +1768,155 @@ void MainWindow::handleRecharge(const QString &account, double amount, const QSt
                           amount,
                           m_currentUser.account,
                           note,
-                          it->balance};
+                          it->balance,
+                          m_accounts.intern(account)};
     m_recharges.insert(m_recharges.begin(), record);
 
-    if (!persistUsers())
+    if (!m_repository || !m_repository->commitUserChanges({UserChange{UserChange::Op::Balance, *it}}))
     {
         showThemedWarning(this, windowTitle(), QStringLiteral(u"保存用户余额失败，请稍后重试。"));
         return;
     }
+    checkpointUsersIfNeeded();
+
+    warnOnFailure(m_asyncRepository->appendRechargeRecord(record));
+
+    refreshRechargePage();
+    refreshUsersPage();
+    refreshBillingSummary();
+    showThemedInformation(this, windowTitle(), QStringLiteral(u"余额已更新。"));
+}
+
+void MainWindow::handleBulkRecharge()
+{
+    if (!m_isAdmin || !m_repository)
+        return;
+
+    const QString source = QFileDialog::getOpenFileName(this,
+                                                        QStringLiteral(u"批量充值"),
+                                                        QString(),
+                                                        QStringLiteral(u"CSV 文件 (*.csv);;所有文件 (*.*)"));
+    if (source.isEmpty())
+        return;
+
+    // 先整体校验，任何一条有误都不改动余额
+    QStringList errors;
+    const std::vector<RechargeRequest> requests = Repository::loadRechargeRequests(source, &errors);
+    std::vector<int> indexes;
+    indexes.reserve(requests.size());
+    Money total;
+    for (const auto &request : requests)
+    {
+        const int index = userIndexOf(request.account);
+        if (index < 0)
+            errors.append(QStringLiteral(u"第 %1 条：账号 %2 不存在").arg(request.record).arg(request.account));
+        else if (request.amount == Money())
+            errors.append(QStringLiteral(u"第 %1 条：金额不能为 0").arg(request.record));
+        indexes.push_back(index);
+        total += request.amount;
+    }
+
+    if (!errors.isEmpty())
+    {
+        constexpr int kShownErrors = 10;
+        QString message = QStringLiteral(u"充值文件有误，未做任何修改：\n%1").arg(errors.mid(0, kShownErrors).join(QLatin1Char('\n')));
+        if (errors.size() > kShownErrors)
+            message += QStringLiteral(u"\n……共 %1 处错误").arg(errors.size());
+        showThemedWarning(this, windowTitle(), message);
+        return;
+    }
+    if (requests.empty())
+    {
+        showThemedInformation(this, windowTitle(), QStringLiteral(u"文件中没有充值记录。"));
+        return;
+    }
+    if (showThemedQuestion(this, windowTitle(),
+                           QStringLiteral(u"将导入 %1 条充值，合计 %2 元，确定继续吗？").arg(requests.size()).arg(total.toString()),
+                           QMessageBox::Yes | QMessageBox::No, QMessageBox::Yes) != QMessageBox::Yes)
+        return;
+
+    // 余额在内存中逐条累加，每个账号只产生一条余额变更
+    const QDateTime timestamp = QDateTime::currentDateTime();
+    std::vector<RechargeRecord> records;
+    records.reserve(requests.size());
+    std::vector<char> touched(m_users.size(), 0);
+    std::vector<UserChange> balanceChanges;
+    std::vector<Money> previousBalances(m_users.size());
+    for (std::size_t i = 0; i < requests.size(); ++i)
+    {
+        const auto slot = static_cast<std::size_t>(indexes[i]);
+        User &user = m_users[slot];
+        if (!touched[slot])
+            previousBalances[slot] = user.balance;
+        user.balance += requests[i].amount;
+        records.push_back(RechargeRecord{user.account,
+                                         timestamp,
+                                         requests[i].amount,
+                                         m_currentUser.account,
+                                         requests[i].note,
+                                         user.balance,
+                                         m_accounts.intern(user.account)});
+        touched[slot] = 1;
+    }
+    for (std::size_t slot = 0; slot < touched.size(); ++slot)
+    {
+        if (touched[slot])
+            balanceChanges.push_back(UserChange{UserChange::Op::Balance, m_users[slot]});
+    }
+
+    // users.ledger 与 bills.csv 各写入一次；余额未能落盘时撤销内存中的改动，也不记流水
+    if (!m_repository->commitUserChanges(balanceChanges))
+    {
+        for (std::size_t slot = 0; slot < touched.size(); ++slot)
+        {
+            if (touched[slot])
+                m_users[slot].balance = previousBalances[slot];
+        }
+        showThemedWarning(this, windowTitle(), QStringLiteral(u"保存用户余额失败，批量充值未生效，请稍后重试。"));
+        return;
+    }
 
-    if (!m_repository->appendRechargeRecord(record))
+    if (m_currentUserIndex >= 0 && m_currentUserIndex < static_cast<int>(touched.size())
+        && touched[static_cast<std::size_t>(m_currentUserIndex)])
     {
-        showThemedWarning(this, windowTitle(), QStringLiteral(u"记录充值流水失败，请检查数据目录权限。"));
+        m_currentUser = m_users[static_cast<std::size_t>(m_currentUserIndex)];
+        m_currentBalance = m_currentUser.balance;
+        updateAccountBanner();
     }
+    // 检查点会把 m_currentUser 写回 m_users，须在同步当前用户之后
+    checkpointUsersIfNeeded();
+    m_recharges.insert(m_recharges.begin(), records.rbegin(), records.rend());
+    warnOnFailure(m_asyncRepository->appendRechargeRecords(std::move(records)));
 
     refreshRechargePage();
     refreshUsersPage();
     refreshBillingSummary();
-    showThemedInformation(this, windowTitle(), QStringLiteral(u"余额已更新。"));
+    showThemedInformation(this, windowTitle(),
+                          QStringLiteral(u"已导入 %1 条充值，涉及 %2 个账号，合计 %3 元。")
+                              .arg(requests.size())
+                              .arg(balanceChanges.size())
+                              .arg(total.toString()));
+}
+
+bool MainWindow::sessionsLoadPending()
+{
+    if (!m_sessionsLoading)
+        return false;
+    showThemedWarning(this, windowTitle(), QStringLiteral(u"正在重新加载上网记录，请稍后再试。"));
+    return true;
+}
+
+bool MainWindow::sessionEditable(const Session &session) const
+{
+    return !m_sessionWindowFrom.isValid() || (session.begin.isValid() && session.begin.date() >= m_sessionWindowFrom);
+}
+
+std::vector<BillLine> MainWindow::computeBills(int year, int month) const
+{
+    // 驻留范围之前的月份不在 m_usage 中，直接由该月分区与 spill.csv 汇总
+    if (m_sessionWindowFrom.isValid() && QDate(year, month, 1) < m_sessionWindowFrom)
+        return m_repository->computeMonthlyStreaming(year, month, m_users);
+    return BillingEngine::computeMonthly(year, month, m_users, m_accounts, m_usage);
 }
 
 QString MainWindow::defaultOutputDir() const
@@ -1442,6 +1924,28 @@ QString MainWindow::defaultOutputDir() const
     return QDir::current().filePath(QStringLiteral("out"));
 }
 
+// 后台任务持有旧 Repository 的副本，重建前先等它们写完
+void MainWindow::resetRepository()
+{
+    m_asyncRepository.reset();
+    m_repository = std::make_unique<Repository>(m_dataDir, m_outputDir);
+    m_asyncRepository = std::make_unique<AsyncRepository>(*m_repository);
+}
+
+void MainWindow::warnOnFailure(const QFuture<RepositoryResult> &future)
+{
+    auto *watcher = new QFutureWatcher<RepositoryResult>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher]()
+            {
+        watcher->deleteLater();
+        if (watcher->isCanceled() || watcher->future().resultCount() == 0)
+            return;
+        const RepositoryResult result = watcher->result();
+        if (!result.ok)
+            showThemedWarning(this, windowTitle(), result.error); });
+    watcher->setFuture(future);
+}
+
 void MainWindow::ensureOutputDir()
 {
     if (m_outputDir.isEmpty())
@@ -1457,18 +1961,84 @@ bool MainWindow::persistUsers()
         return false;
     if (m_currentUserIndex >= 0 && m_currentUserIndex < static_cast<int>(m_users.size()))
         m_users[static_cast<std::size_t>(m_currentUserIndex)] = m_currentUser;
-    const bool ok = m_repository->saveUsers(m_users);
-    if (ok)
-        m_usersDirty = false;
-    return ok;
+
+    // 记录变更时的用户内容可能已被之后的充值或扣费改动，提交前取当前值
+    for (auto &change : m_pendingUserChanges)
+    {
+        if (change.op != UserChange::Op::Upsert)
+            continue;
+        if (const User *user = findUser(change.user.account))
+            change.user = *user;
+    }
+
+    QString error;
+    if (!m_repository->commitUserChanges(m_pendingUserChanges, &error))
+    {
+        qWarning() << error;
+        return false;
+    }
+    m_pendingUserChanges.clear();
+    m_usersDirty = false;
+    checkpointUsersIfNeeded();
+    return true;
+}
+
+void MainWindow::checkpointUsersIfNeeded()
+{
+    // 有未保存的用户修改时 m_users 与日志内容不一致，推迟到保存后再做检查点
+    if (!m_repository || m_usersDirty || !m_repository->userLedgerNeedsCheckpoint())
+        return;
+    if (m_currentUserIndex >= 0 && m_currentUserIndex < static_cast<int>(m_users.size()))
+        m_users[static_cast<std::size_t>(m_currentUserIndex)] = m_currentUser;
+    if (!m_repository->saveUsers(m_users))
+        qWarning() << "Failed to checkpoint users.ledger into users.csv";
 }
 
 bool MainWindow::persistSessions()
 {
     if (!m_repository)
         return false;
-    const bool ok = m_repository->saveSessions(m_sessions);
-    if (ok)
+    if (m_repository->sessionsPartitioned())
+    {
+        // 分区模式下只重写受影响月份的分区，不经过日志
+        std::vector<QDate> months;
+        for (const auto &change : m_pendingSessionChanges)
+        {
+            if (change.session.begin.isValid())
+                months.push_back(change.session.begin.date());
+        }
+        if (!m_repository->saveSessionPartitions(m_sessions, months, m_sessionWindowFrom))
+        {
+            qWarning() << "Failed to write session partitions";
+            return false;
+        }
+        m_pendingSessionChanges.clear();
         m_sessionsDirty = false;
-    return ok;
+        return true;
+    }
+
+    QString error;
+    if (!m_repository->appendSessionChanges(m_pendingSessionChanges, &error))
+    {
+        qWarning() << error;
+        return false;
+    }
+    m_pendingSessionChanges.clear();
+    m_sessionsDirty = false;
+    compactSessionsInBackground();
+    return true;
+}
+
+void MainWindow::compactSessionsInBackground()
+{
+    // 单线程池保证同一时刻只有一次压缩，压缩期间保存的变更写入新日志
+    if (!m_repository || m_sessionCompactor.activeThreadCount() > 0)
+        return;
+    if (!m_repository->sessionJournalNeedsCompaction() || !m_repository->beginSessionCompaction())
+        return;
+
+    m_sessionCompactor.start([repository = *m_repository, sessions = m_sessions]()
+                             {
+        if (!repository.finishSessionCompaction(sessions))
+            qWarning() << "Failed to compact sessions.journal"; });
 }
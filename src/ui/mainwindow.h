@@ -1,18 +1,27 @@
 #pragma once
 
 #include "ElaWindow.h"
+#include "backend/AccountDirectory.h"
 #include "backend/Models.h"
+#include "backend/SessionJournal.h"
 #include "backend/SettingsManager.h"
+#include "backend/UsageStore.h"
 
+#include <QDate>
+#include <QFuture>
 #include <QList>
 #include <QPointer>
 #include <QPair>
 #include <QStringList>
+#include <QThreadPool>
 #include <QVector>
 #include <memory>
 #include <vector>
 
 class Repository;
+class AsyncRepository;
+struct RepositoryResult;
+struct UserChange;
 class DashboardPage;
 class UsersPage;
 class SessionsPage;
@@ -55,6 +64,9 @@ private:
     void refreshBillingSummary();
     void refreshRechargePage();
     void resetComputedBills();
+    void reindexUsers();
+    int userIndexOf(const QString &account) const;
+    User *findUser(const QString &account);
     QVector<QPair<QString, double>> collectPersonalTrend(const QString &account) const;
 
     void handleCreateUser();
@@ -68,21 +80,32 @@ private:
     void handleDeleteSessions(const QList<Session> &sessions);
     void handleReloadSessions();
     void handleSaveSessions();
+    void adoptLoadedSessions(std::vector<Session> sessions);
     void handleGenerateRandomSessions();
     void handleChangePasswordRequest();
     void handleSwitchAccountRequested();
     void handleBackupRequested();
     void handleRestoreRequested();
+    void handlePartitionSessionsRequested();
 
     void handleComputeBilling();
     void handleExportBilling();
-    void handleRecharge(const QString &account, double amount, const QString &note, bool selfService);
+    void handleExportArchivedBill();
+    void handleRecharge(const QString &account, Money amount, const QString &note, bool selfService);
+    void handleBulkRecharge();
     void handleStackIndexChanged();
 
     QString defaultOutputDir() const;
+    bool sessionEditable(const Session &session) const;
+    bool sessionsLoadPending();
+    std::vector<BillLine> computeBills(int year, int month) const;
+    void resetRepository();
+    void warnOnFailure(const QFuture<RepositoryResult> &future);
     void ensureOutputDir();
     bool persistUsers();
+    void checkpointUsersIfNeeded();
     bool persistSessions();
+    void compactSessionsInBackground();
 
     User m_currentUser;
     bool m_isAdmin{false};
@@ -97,19 +120,28 @@ private:
     std::unique_ptr<SettingsPage> m_settingsPage;
 
     std::unique_ptr<Repository> m_repository;
+    std::unique_ptr<AsyncRepository> m_asyncRepository; // 充值流水、账单与备份导出在其线程池中执行
     std::vector<User> m_users;
+    std::vector<UserChange> m_pendingUserChanges; // 上次保存以来的用户增删改，保存时写入 users.ledger
     std::vector<Session> m_sessions;
+    QDate m_sessionWindowFrom; // 分区模式下 m_sessions 只含与该月及之后有交集的会话；无效表示全部驻留
+    std::vector<SessionChange> m_pendingSessionChanges; // 上次保存以来的变更，保存时追加到日志
+    QThreadPool m_sessionCompactor;
+    AccountDirectory m_accounts;
+    std::vector<int> m_userSlots; // AccountId -> m_users 下标
+    UsageStore m_usage;
     std::vector<BillLine> m_latestBills;
     std::vector<RechargeRecord> m_recharges;
 
     bool m_usersDirty{false};
     bool m_sessionsDirty{false};
+    bool m_sessionsLoading{false}; // 后台重新加载上网记录期间为 true
     QString m_dataDir;
     QString m_outputDir;
     bool m_hasComputed{false};
     int m_lastBillYear{0};
     int m_lastBillMonth{0};
-    double m_currentBalance{0.0};
+    Money m_currentBalance;
     int m_currentUserIndex{-1};
     QString m_lastBillingInfo;
     bool m_rechargesDirty{false};
@@ -5,6 +5,7 @@
 #include "ElaPushButton.h"
 #include "ElaTableView.h"
 #include "ElaText.h"
+#include "backend/Billing.h"
 #include "backend/models.h"
 #include "ui/ThemeUtils.h"
 
@@ -23,27 +24,6 @@
 #include <algorithm>
 #include <limits>
 
-namespace
-{
-    QString planToString(int plan)
-    {
-        switch (static_cast<Tariff>(plan))
-        {
-        case Tariff::NoDiscount:
-            return QStringLiteral(u"标准计费");
-        case Tariff::Pack30h:
-            return QStringLiteral(u"30 小时套餐");
-        case Tariff::Pack60h:
-            return QStringLiteral(u"60 小时套餐");
-        case Tariff::Pack150h:
-            return QStringLiteral(u"150 小时套餐");
-        case Tariff::Unlimited:
-            return QStringLiteral(u"包月不限时");
-        }
-        return QStringLiteral(u"未知套餐");
-    }
-} // namespace
-
 BillingPage::BillingPage(QWidget *parent)
     : BasePage(QStringLiteral(u"账单结算"),
                QStringLiteral(u"选择统计年月并生成账单，可导出至指定目录。"),
@@ -70,6 +50,8 @@ void BillingPage::setupToolbar()
     m_browseButton = new ElaPushButton(QStringLiteral(u"浏览"), this);
     m_computeButton = new ElaPushButton(QStringLiteral(u"生成账单"), this);
     m_exportButton = new ElaPushButton(QStringLiteral(u"导出账单"), this);
+    m_archiveExportButton = new ElaPushButton(QStringLiteral(u"从存档导出"), this);
+    m_archiveExportButton->setToolTip(QStringLiteral(u"直接由已保存的上网记录汇总所选月份并导出账单，不扣费"));
 
     auto *timeLabel = new ElaText(QStringLiteral(u"统计时间"), m_toolbar);
     controlsLayout->addWidget(timeLabel);
@@ -92,6 +74,7 @@ void BillingPage::setupToolbar()
 
     controlsLayout->addWidget(m_computeButton);
     controlsLayout->addWidget(m_exportButton);
+    controlsLayout->addWidget(m_archiveExportButton);
 
     layout->addLayout(controlsLayout);
 
@@ -111,6 +94,7 @@ void BillingPage::setupToolbar()
 
     connect(m_computeButton, &ElaPushButton::clicked, this, &BillingPage::requestCompute);
     connect(m_exportButton, &ElaPushButton::clicked, this, &BillingPage::requestExport);
+    connect(m_archiveExportButton, &ElaPushButton::clicked, this, &BillingPage::requestArchiveExport);
     connect(m_browseButton, &ElaPushButton::clicked, this, &BillingPage::requestBrowseOutputDir);
 
     const QDate today = QDate::currentDate();
@@ -179,7 +163,7 @@ void BillingPage::setBillLines(const std::vector<BillLine> &lines)
         nameItem->setData(line.name, Qt::UserRole);
         m_model->setItem(row, 1, nameItem);
 
-        const QString planText = planToString(line.plan);
+        const QString planText = BillingEngine::tariffs().name(line.plan);
         auto *planItem = new QStandardItem(planText);
         planItem->setEditable(false);
         planItem->setData(static_cast<int>(line.plan), Qt::UserRole);
@@ -190,9 +174,9 @@ void BillingPage::setBillLines(const std::vector<BillLine> &lines)
         minutesItem->setData(line.minutes, Qt::UserRole);
         m_model->setItem(row, 3, minutesItem);
 
-        auto *amountItem = new QStandardItem(locale.toString(line.amount, 'f', 2));
+        auto *amountItem = new QStandardItem(locale.toString(line.amount.toYuan(), 'f', 2));
         amountItem->setEditable(false);
-        amountItem->setData(line.amount, Qt::UserRole);
+        amountItem->setData(line.amount.toYuan(), Qt::UserRole);
         m_model->setItem(row, 4, amountItem);
     }
 
@@ -302,21 +286,21 @@ int BillingPage::ensureYearOption(ElaComboBox *combo, int year) const
     return combo->findData(year);
 }
 
-void BillingPage::setSummary(int totalMinutes, double totalAmount, int userCount)
+void BillingPage::setSummary(int totalMinutes, Money totalAmount, int userCount)
 {
     const QLocale locale(QLocale::Chinese, QLocale::China);
     if (m_userMode)
     {
         m_summaryText = QStringLiteral(u"本月上网共计 %1 分钟，应扣费用 %2 元。")
                             .arg(totalMinutes)
-                            .arg(locale.toString(totalAmount, 'f', 2));
+                            .arg(locale.toString(totalAmount.toYuan(), 'f', 2));
     }
     else
     {
         m_summaryText = QStringLiteral(u"共 %1 位用户，上网时长累计 %2 分钟，账单金额合计 %3 元。")
                             .arg(userCount)
                             .arg(totalMinutes)
-                            .arg(locale.toString(totalAmount, 'f', 2));
+                            .arg(locale.toString(totalAmount.toYuan(), 'f', 2));
     }
     updateSummaryLabel();
 }
@@ -375,6 +359,8 @@ void BillingPage::setUserMode(bool userMode)
     const bool showExportControls = !m_userMode;
     if (m_exportButton)
         m_exportButton->setVisible(showExportControls);
+    if (m_archiveExportButton)
+        m_archiveExportButton->setVisible(showExportControls);
     if (m_browseButton)
         m_browseButton->setVisible(showExportControls);
     if (m_outputRow)
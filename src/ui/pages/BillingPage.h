@@ -1,6 +1,7 @@
 #pragma once
 
 #include "ui/pages/BasePage.h"
+#include "backend/Money.h"
 
 #include <memory>
 #include <QDate>
@@ -26,7 +27,7 @@ public:
     explicit BillingPage(QWidget *parent = nullptr);
 
     void setBillLines(const std::vector<BillLine> &lines);
-    void setSummary(int totalMinutes, double totalAmount, int userCount);
+    void setSummary(int totalMinutes, Money totalAmount, int userCount);
     void setOutputDirectory(const QString &path);
     int selectedYear() const;
     int selectedMonth() const;
@@ -37,6 +38,7 @@ public:
 Q_SIGNALS:
     void requestCompute();
     void requestExport();
+    void requestArchiveExport();
     void requestBrowseOutputDir();
 
 private:
@@ -57,6 +59,7 @@ private:
     ElaPushButton *m_browseButton{nullptr};
     ElaPushButton *m_computeButton{nullptr};
     ElaPushButton *m_exportButton{nullptr};
+    ElaPushButton *m_archiveExportButton{nullptr};
     ElaTableView *m_table{nullptr};
     ElaText *m_summaryLabel{nullptr};
     std::unique_ptr<QStandardItemModel> m_model;
@@ -37,8 +37,8 @@ void DashboardPage::updateOverview(const User &currentUser,
                                    int totalUsers,
                                    int totalSessions,
                                    double totalMinutes,
-                                   double totalAmount,
-                                   double balance,
+                                   Money totalAmount,
+                                   Money balance,
                                    const QString &lastBillingInfo)
 {
     const auto buildIdentity = [&currentUser]()
@@ -65,20 +65,20 @@ void DashboardPage::updateOverview(const User &currentUser,
                                    .arg(totalUsers)
                                    .arg(totalSessions)
                                    .arg(static_cast<long long>(totalMinutes))
-                                   .arg(QString::number(totalAmount, 'f', 2)));
+                                   .arg(totalAmount.toString()));
         m_hintText->setText(lastBillingInfo.isEmpty()
                                 ? QStringLiteral(u"还未生成账单，建议及时结算。")
-                                : QStringLiteral(u"%1\n账户余额提醒: %2 元").arg(lastBillingInfo, QString::number(balance, 'f', 2)));
+                                : QStringLiteral(u"%1\n账户余额提醒: %2 元").arg(lastBillingInfo, balance.toString()));
     }
     else
     {
         m_summaryText->setText(QStringLiteral(u"当前余额：%1 元。累计上网时长约 %2 分钟。")
-                                   .arg(QString::number(balance, 'f', 2))
+                                   .arg(balance.toString())
                                    .arg(static_cast<long long>(totalMinutes)));
-        if (balance < 0)
+        if (balance < Money())
             m_hintText->setText(QStringLiteral(u"您的余额已为负，请尽快充值以免影响上网服务。"));
-        else if (balance < 20)
-            m_hintText->setText(QStringLiteral(u"余额即将不足 (%1 元)，建议及时充值。").arg(QString::number(balance, 'f', 2)));
+        else if (balance < Money::fromCents(2000))
+            m_hintText->setText(QStringLiteral(u"余额即将不足 (%1 元)，建议及时充值。").arg(balance.toString()));
         else
             m_hintText->setText(lastBillingInfo);
     }
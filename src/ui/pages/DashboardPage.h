@@ -18,8 +18,8 @@ public:
                         int totalUsers,
                         int totalSessions,
                         double totalMinutes,
-                        double totalAmount,
-                        double balance,
+                        Money totalAmount,
+                        Money balance,
                         const QString &lastBillingInfo);
 
 private:
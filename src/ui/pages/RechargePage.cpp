@@ -72,7 +72,7 @@ void RechargePage::setupToolbar()
     m_amountValidator = new QDoubleValidator(-1000000.0, 1000000.0, 2, m_amountEdit);
     m_amountValidator->setNotation(QDoubleValidator::StandardNotation);
     m_amountEdit->setValidator(m_amountValidator);
-    setAmount(50.0);
+    setAmount(Money::fromCents(5000));
 
     m_noteEdit = new ElaLineEdit(this);
     m_noteEdit->setPlaceholderText(QStringLiteral(u"备注，可选"));
@@ -82,11 +82,15 @@ void RechargePage::setupToolbar()
     m_balanceLabel->setWordWrap(true);
 
     m_rechargeButton = new ElaPushButton(QStringLiteral(u"确认操作"), this);
+    m_importButton = new ElaPushButton(QStringLiteral(u"批量导入"), this);
+    m_importButton->setToolTip(QStringLiteral(u"从 CSV 文件（账号,金额,备注）批量充值"));
+    m_importButton->setVisible(false);
 
     layout->addWidget(new ElaText(QStringLiteral(u"金额"), this));
     layout->addWidget(m_amountEdit);
     layout->addWidget(m_noteEdit, 1);
     layout->addWidget(m_rechargeButton);
+    layout->addWidget(m_importButton);
 
     bodyLayout()->addWidget(toolbar);
     bodyLayout()->addWidget(m_balanceLabel);
@@ -95,13 +99,15 @@ void RechargePage::setupToolbar()
             {
                 const QString account = selectedAccount();
                 bool ok = false;
-                const double amount = currentAmount(&ok);
+                const Money amount = currentAmount(&ok);
                 if (account.isEmpty() || !ok)
                     return;
-                if (!m_adminMode && amount < 0.01)
+                if (!m_adminMode && amount < Money::fromCents(1))
                     return;
                 emit rechargeRequested(account, amount, m_noteEdit->text().trimmed(), !m_adminMode); });
 
+    connect(m_importButton, &ElaPushButton::clicked, this, &RechargePage::bulkRechargeRequested);
+
     if (m_accountSearch)
     {
         connect(m_accountSearch, &ElaLineEdit::textChanged, this, [this]
@@ -153,6 +159,8 @@ void RechargePage::setAdminMode(bool adminMode)
         if (!m_adminMode)
             m_accountSearch->clear();
     }
+    if (m_importButton)
+        m_importButton->setVisible(m_adminMode);
     if (!m_adminMode)
     {
         m_noteEdit->setPlaceholderText(QStringLiteral(u"可填写备注"));
@@ -162,9 +170,9 @@ void RechargePage::setAdminMode(bool adminMode)
         if (m_amountValidator)
             m_amountValidator->setRange(0.01, 1000000.0, 2);
         bool ok = false;
-        const double amount = currentAmount(&ok);
-        if (!ok || amount < 0.01)
-            setAmount(50.0);
+        const Money amount = currentAmount(&ok);
+        if (!ok || amount < Money::fromCents(1))
+            setAmount(Money::fromCents(5000));
         if (m_accountDisplay)
             m_accountDisplay->setToolTip(QString());
     }
@@ -205,7 +213,7 @@ void RechargePage::setRechargeRecords(const std::vector<RechargeRecord> &records
     {
         const auto &record = records[static_cast<std::size_t>(row)];
         const QString name = m_accountNames.value(record.account);
-        const QString typeText = record.amount >= 0 ? QStringLiteral(u"充值") : QStringLiteral(u"扣费");
+        const QString typeText = record.amount >= Money() ? QStringLiteral(u"充值") : QStringLiteral(u"扣费");
 
         auto *timeItem = new QStandardItem(record.timestamp.toString(QStringLiteral("yyyy-MM-dd HH:mm:ss")));
         timeItem->setEditable(false);
@@ -227,19 +235,19 @@ void RechargePage::setRechargeRecords(const std::vector<RechargeRecord> &records
         typeItem->setData(typeText, Qt::UserRole);
         m_model->setItem(row, 3, typeItem);
 
-        const QString amountText = locale.toString(record.amount, 'f', 2);
+        const QString amountText = locale.toString(record.amount.toYuan(), 'f', 2);
         auto *amountItem = new QStandardItem(amountText);
         amountItem->setEditable(false);
-        if (record.amount < 0)
+        if (record.amount < Money())
             amountItem->setForeground(QBrush(Qt::red));
-        amountItem->setData(record.amount, Qt::UserRole);
+        amountItem->setData(record.amount.toYuan(), Qt::UserRole);
         m_model->setItem(row, 4, amountItem);
 
-        auto *balanceItem = new QStandardItem(locale.toString(record.balanceAfter, 'f', 2));
+        auto *balanceItem = new QStandardItem(locale.toString(record.balanceAfter.toYuan(), 'f', 2));
         balanceItem->setEditable(false);
-        if (record.balanceAfter < 0)
+        if (record.balanceAfter < Money())
             balanceItem->setForeground(QBrush(Qt::red));
-        balanceItem->setData(record.balanceAfter, Qt::UserRole);
+        balanceItem->setData(record.balanceAfter.toYuan(), Qt::UserRole);
         m_model->setItem(row, 5, balanceItem);
 
         auto *operatorItem = new QStandardItem(record.operatorAccount);
@@ -290,14 +298,14 @@ void RechargePage::setCurrentAccount(const QString &account)
     }
 }
 
-void RechargePage::setCurrentBalance(double balance)
+void RechargePage::setCurrentBalance(Money balance)
 {
     const QLocale locale(QLocale::Chinese, QLocale::China);
-    const QString text = QStringLiteral(u"当前余额：%1 元").arg(locale.toString(balance, 'f', 2));
+    const QString text = QStringLiteral(u"当前余额：%1 元").arg(locale.toString(balance.toYuan(), 'f', 2));
     m_balanceLabel->setText(text);
-    if (balance < 0)
+    if (balance < Money())
         m_balanceLabel->setText(QStringLiteral(u"%1（已欠费，请尽快充值）").arg(text));
-    else if (balance < 20)
+    else if (balance < Money::fromCents(2000))
         m_balanceLabel->setText(QStringLiteral(u"%1（余额即将不足，请关注）").arg(text));
 }
 
@@ -308,26 +316,26 @@ QString RechargePage::selectedAccount() const
     return m_currentAccount;
 }
 
-double RechargePage::currentAmount(bool *ok) const
+Money RechargePage::currentAmount(bool *ok) const
 {
     if (!m_amountEdit)
     {
         if (ok)
             *ok = false;
-        return 0.0;
+        return Money();
     }
     bool localOk = false;
-    const double value = m_amountEdit->text().trimmed().toDouble(&localOk);
+    const Money value = Money::parse(m_amountEdit->text(), &localOk);
     if (ok)
         *ok = localOk;
-    return localOk ? value : 0.0;
+    return localOk ? value : Money();
 }
 
-void RechargePage::setAmount(double amount)
+void RechargePage::setAmount(Money amount)
 {
     if (!m_amountEdit)
         return;
-    m_amountEdit->setText(QString::number(amount, 'f', 2));
+    m_amountEdit->setText(amount.toString());
 }
 
 void RechargePage::applyAccountFilter()
@@ -32,18 +32,19 @@ public:
     void setUsers(const std::vector<User> &users);
     void setRechargeRecords(const std::vector<RechargeRecord> &records);
     void setCurrentAccount(const QString &account);
-    void setCurrentBalance(double balance);
+    void setCurrentBalance(Money balance);
 
 Q_SIGNALS:
-    void rechargeRequested(const QString &account, double amount, const QString &note, bool selfService);
+    void rechargeRequested(const QString &account, Money amount, const QString &note, bool selfService);
+    void bulkRechargeRequested();
 
 private:
     void setupToolbar();
     void setupTable();
     void reloadPageData() override;
     QString selectedAccount() const;
-    double currentAmount(bool *ok = nullptr) const;
-    void setAmount(double amount);
+    Money currentAmount(bool *ok = nullptr) const;
+    void setAmount(Money amount);
     void applyAccountFilter();
 
     bool m_adminMode{false};
@@ -56,6 +57,7 @@ private:
     QDoubleValidator *m_amountValidator{nullptr};
     ElaLineEdit *m_noteEdit{nullptr};
     ElaPushButton *m_rechargeButton{nullptr};
+    ElaPushButton *m_importButton{nullptr};
     ElaText *m_balanceLabel{nullptr};
     ElaTableView *m_table{nullptr};
     std::unique_ptr<QStandardItemModel> m_model;
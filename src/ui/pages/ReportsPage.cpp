@@ -3,6 +3,7 @@
 #include "ElaPushButton.h"
 #include "ElaTableView.h"
 #include "ElaText.h"
+#include "backend/Billing.h"
 #include "backend/Models.h"
 #include "ui/ThemeUtils.h"
 
@@ -37,23 +38,6 @@ namespace
         return (index >= 0 && index < labels.size()) ? labels.at(index) : QString();
     }
 
-    QString planLabel(int plan)
-    {
-        switch (static_cast<Tariff>(plan))
-        {
-        case Tariff::NoDiscount:
-            return QStringLiteral(u"标准计费");
-        case Tariff::Pack30h:
-            return QStringLiteral(u"30 小时套餐");
-        case Tariff::Pack60h:
-            return QStringLiteral(u"60 小时套餐");
-        case Tariff::Pack150h:
-            return QStringLiteral(u"150 小时套餐");
-        case Tariff::Unlimited:
-            return QStringLiteral(u"包月不限时");
-        }
-        return QStringLiteral(u"未知套餐");
-    }
 } // namespace
 
 ReportsPage::ReportsPage(QWidget *parent)
@@ -173,7 +157,7 @@ void ReportsPage::setupContent()
     refreshVisibility();
 }
 
-void ReportsPage::setMonthlySummary(int year, int month, const QVector<int> &usageBuckets, double totalAmount, bool hasBillingData)
+void ReportsPage::setMonthlySummary(int year, int month, const QVector<int> &usageBuckets, Money totalAmount, bool hasBillingData)
 {
     m_currentYear = year;
     m_currentMonth = month;
@@ -243,7 +227,7 @@ void ReportsPage::setMonthlySummary(int year, int month, const QVector<int> &usa
         const QString summaryText = QStringLiteral(u"%1 年 %2 月累计应收 %3 元，覆盖 %4 位用户。")
                                         .arg(year)
                                         .arg(month, 2, 10, QLatin1Char('0'))
-                                        .arg(locale.toString(totalAmount, 'f', 2))
+                                        .arg(locale.toString(totalAmount.toYuan(), 'f', 2))
                                         .arg(totalUsers);
         if (m_summary)
             m_summary->setText(summaryText);
@@ -256,18 +240,19 @@ void ReportsPage::setMonthlySummary(int year, int month, const QVector<int> &usa
     refreshVisibility();
 }
 
-void ReportsPage::setPlanDistribution(const QVector<int> &planCounts, const QVector<double> &planAmounts)
+void ReportsPage::setPlanDistribution(const QVector<int> &planCounts, const QVector<Money> &planAmounts)
 {
     m_planCounts = planCounts;
     m_planAmounts = planAmounts;
-    if (m_planCounts.size() < 5)
-        m_planCounts.resize(5);
-    if (m_planAmounts.size() < 5)
-        m_planAmounts.resize(5);
+    const int planCount = BillingEngine::tariffs().planCount();
+    if (m_planCounts.size() < planCount)
+        m_planCounts.resize(planCount);
+    if (m_planAmounts.size() < planCount)
+        m_planAmounts.resize(planCount);
     updatePlanTable();
 }
 
-void ReportsPage::setFinancialSummary(double billedAmount, double rechargeIncome, double refundAmount, double netIncome)
+void ReportsPage::setFinancialSummary(Money billedAmount, Money rechargeIncome, Money refundAmount, Money netIncome)
 {
     m_totalAmount = billedAmount;
     m_rechargeIncome = rechargeIncome;
@@ -281,8 +266,9 @@ void ReportsPage::updatePlanTable()
     if (!m_planModel)
         return;
 
-    constexpr int kPlanRows = 6; // 5 套餐 + 合计
-    m_planModel->setRowCount(kPlanRows);
+    const auto &plans = BillingEngine::tariffs().plans();
+    const int planRows = static_cast<int>(plans.size()) + 1; // 各套餐 + 合计
+    m_planModel->setRowCount(planRows);
 
     const auto ensureItem = [this](QStandardItemModel *model, int row, int column) -> QStandardItem *
     {
@@ -297,38 +283,39 @@ void ReportsPage::updatePlanTable()
 
     const QLocale locale(QLocale::Chinese, QLocale::China);
     int totalUsers = 0;
-    double totalAmount = 0.0;
+    Money totalAmount;
 
-    for (int plan = 0; plan < 5; ++plan)
+    for (int row = 0; row < static_cast<int>(plans.size()); ++row)
     {
-        if (auto *labelItem = ensureItem(m_planModel.get(), plan, 0))
+        const int plan = plans[static_cast<std::size_t>(row)].id;
+        if (auto *labelItem = ensureItem(m_planModel.get(), row, 0))
         {
-            labelItem->setText(planLabel(plan));
+            labelItem->setText(plans[static_cast<std::size_t>(row)].name);
             labelItem->setEditable(false);
             labelItem->setData(labelItem->text(), Qt::UserRole);
         }
 
         const int users = (m_hasBillingData && plan < m_planCounts.size()) ? m_planCounts.at(plan) : 0;
-        const double amount = (m_hasBillingData && plan < m_planAmounts.size()) ? m_planAmounts.at(plan) : 0.0;
+        const Money amount = (m_hasBillingData && plan < m_planAmounts.size()) ? m_planAmounts.at(plan) : Money();
         totalUsers += users;
         totalAmount += amount;
 
-        if (auto *usersItem = ensureItem(m_planModel.get(), plan, 1))
+        if (auto *usersItem = ensureItem(m_planModel.get(), row, 1))
         {
             usersItem->setText(QString::number(users));
             usersItem->setEditable(false);
             usersItem->setData(users, Qt::UserRole);
         }
 
-        if (auto *amountItem = ensureItem(m_planModel.get(), plan, 2))
+        if (auto *amountItem = ensureItem(m_planModel.get(), row, 2))
         {
-            amountItem->setText(locale.toString(amount, 'f', 2));
+            amountItem->setText(locale.toString(amount.toYuan(), 'f', 2));
             amountItem->setEditable(false);
-            amountItem->setData(amount, Qt::UserRole);
+            amountItem->setData(amount.toYuan(), Qt::UserRole);
         }
     }
 
-    const int totalRow = 5;
+    const int totalRow = planRows - 1;
     if (auto *totalLabel = ensureItem(m_planModel.get(), totalRow, 0))
     {
         totalLabel->setText(QStringLiteral(u"合计"));
@@ -343,20 +330,20 @@ void ReportsPage::updatePlanTable()
     }
     if (auto *totalAmountItem = ensureItem(m_planModel.get(), totalRow, 2))
     {
-        totalAmountItem->setText(locale.toString(totalAmount, 'f', 2));
+        totalAmountItem->setText(locale.toString(totalAmount.toYuan(), 'f', 2));
         totalAmountItem->setEditable(false);
-        totalAmountItem->setData(totalAmount, Qt::UserRole);
+        totalAmountItem->setData(totalAmount.toYuan(), Qt::UserRole);
     }
 
     if (m_planTable)
     {
-        QTimer::singleShot(0, this, [this]
+        QTimer::singleShot(0, this, [this, planRows]
                            {
                                if (!m_planTable)
                                    return;
                                m_planTable->resizeRowsToContents();
                                resizeTableToFit(m_planTable);
-                               setTableFixedHeight(m_planTable, 6); });
+                               setTableFixedHeight(m_planTable, planRows); });
     }
 
     refreshVisibility();
@@ -388,16 +375,16 @@ void ReportsPage::updateFinanceTable()
         QStringLiteral(u"退款/扣费支出"),
         QStringLiteral(u"净入账")};
 
-    const double values[kFinanceRows] = {
-        m_hasBillingData ? m_totalAmount : 0.0,
-        m_hasBillingData ? m_rechargeIncome : 0.0,
-        m_hasBillingData ? m_refundAmount : 0.0,
-        m_hasBillingData ? m_netIncome : 0.0};
+    const Money values[kFinanceRows] = {
+        m_hasBillingData ? m_totalAmount : Money(),
+        m_hasBillingData ? m_rechargeIncome : Money(),
+        m_hasBillingData ? m_refundAmount : Money(),
+        m_hasBillingData ? m_netIncome : Money()};
 
     const QString notes[kFinanceRows] = {
         QString(),
         QString(),
-        (m_hasBillingData && m_refundAmount > 0) ? QStringLiteral(u"含管理员扣费") : QString(),
+        (m_hasBillingData && m_refundAmount > Money()) ? QStringLiteral(u"含管理员扣费") : QString(),
         QStringLiteral(u"充值减去退款")};
 
     for (int row = 0; row < kFinanceRows; ++row)
@@ -410,9 +397,9 @@ void ReportsPage::updateFinanceTable()
         }
         if (auto *valueItem = ensureItem(m_financeModel.get(), row, 1))
         {
-            valueItem->setText(locale.toString(values[row], 'f', 2));
+            valueItem->setText(locale.toString(values[row].toYuan(), 'f', 2));
             valueItem->setEditable(false);
-            valueItem->setData(values[row], Qt::UserRole);
+            valueItem->setData(values[row].toYuan(), Qt::UserRole);
         }
         if (auto *noteItem = ensureItem(m_financeModel.get(), row, 2))
         {
@@ -545,7 +532,7 @@ void ReportsPage::exportStatistics(ExportFormat format)
     writeRow({QStringLiteral(u"统计月份"), QStringLiteral(u"用户数"), QStringLiteral(u"应收金额(元)")});
     writeRow({QStringLiteral("%1-%2").arg(m_currentYear).arg(m_currentMonth, 2, 10, QLatin1Char('0')),
               QString::number(std::accumulate(m_usageBuckets.begin(), m_usageBuckets.end(), 0)),
-              locale.toString(m_totalAmount, 'f', 2)});
+              locale.toString(m_totalAmount.toYuan(), 'f', 2)});
     writeSection(QString());
 
     writeSection(QStringLiteral(u"上网时长区间分布"));
@@ -558,24 +545,24 @@ void ReportsPage::exportStatistics(ExportFormat format)
 
     writeSection(QStringLiteral(u"各套餐用户分布"));
     writeRow({QStringLiteral(u"套餐"), QStringLiteral(u"用户数"), QStringLiteral(u"应收金额(元)")});
-    const int planCount = 5;
-    for (int plan = 0; plan < planCount; ++plan)
+    for (const auto &tariff : BillingEngine::tariffs().plans())
     {
+        const int plan = tariff.id;
         const int users = (plan < m_planCounts.size()) ? m_planCounts.at(plan) : 0;
-        const double amount = (plan < m_planAmounts.size()) ? m_planAmounts.at(plan) : 0.0;
-        writeRow({planLabel(plan), QString::number(users), locale.toString(amount, 'f', 2)});
+        const Money amount = (plan < m_planAmounts.size()) ? m_planAmounts.at(plan) : Money();
+        writeRow({tariff.name, QString::number(users), locale.toString(amount.toYuan(), 'f', 2)});
     }
     writeRow({QStringLiteral(u"合计"),
               QString::number(std::accumulate(m_planCounts.begin(), m_planCounts.end(), 0)),
-              locale.toString(std::accumulate(m_planAmounts.begin(), m_planAmounts.end(), 0.0), 'f', 2)});
+              locale.toString(std::accumulate(m_planAmounts.begin(), m_planAmounts.end(), Money()).toYuan(), 'f', 2)});
     writeSection(QString());
 
     writeSection(QStringLiteral(u"系统收入概览"));
     writeRow({QStringLiteral(u"指标"), QStringLiteral(u"金额(元)")});
-    writeRow({QStringLiteral(u"本月应收账单"), locale.toString(m_totalAmount, 'f', 2)});
-    writeRow({QStringLiteral(u"累计充值入账"), locale.toString(m_rechargeIncome, 'f', 2)});
-    writeRow({QStringLiteral(u"退款/扣费支出"), locale.toString(m_refundAmount, 'f', 2)});
-    writeRow({QStringLiteral(u"净入账"), locale.toString(m_netIncome, 'f', 2)});
+    writeRow({QStringLiteral(u"本月应收账单"), locale.toString(m_totalAmount.toYuan(), 'f', 2)});
+    writeRow({QStringLiteral(u"累计充值入账"), locale.toString(m_rechargeIncome.toYuan(), 'f', 2)});
+    writeRow({QStringLiteral(u"退款/扣费支出"), locale.toString(m_refundAmount.toYuan(), 'f', 2)});
+    writeRow({QStringLiteral(u"净入账"), locale.toString(m_netIncome.toYuan(), 'f', 2)});
 
     file.close();
     showThemedInformation(this, windowTitle(), QStringLiteral(u"统计报表已导出。"));
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "ui/pages/BasePage.h"
+#include "backend/Money.h"
 
 #include <memory>
 #include <QStandardItemModel>
@@ -20,9 +21,9 @@ class ReportsPage : public BasePage
 public:
     explicit ReportsPage(QWidget *parent = nullptr);
 
-    void setMonthlySummary(int year, int month, const QVector<int> &usageBuckets, double totalAmount, bool hasBillingData);
-    void setPlanDistribution(const QVector<int> &planCounts, const QVector<double> &planAmounts);
-    void setFinancialSummary(double billedAmount, double rechargeIncome, double refundAmount, double netIncome);
+    void setMonthlySummary(int year, int month, const QVector<int> &usageBuckets, Money totalAmount, bool hasBillingData);
+    void setPlanDistribution(const QVector<int> &planCounts, const QVector<Money> &planAmounts);
+    void setFinancialSummary(Money billedAmount, Money rechargeIncome, Money refundAmount, Money netIncome);
 
 private:
     enum class ExportFormat
@@ -57,11 +58,11 @@ private:
 
     QVector<int> m_usageBuckets;
     QVector<int> m_planCounts;
-    QVector<double> m_planAmounts;
-    double m_totalAmount{0.0};
-    double m_rechargeIncome{0.0};
-    double m_refundAmount{0.0};
-    double m_netIncome{0.0};
+    QVector<Money> m_planAmounts;
+    Money m_totalAmount;
+    Money m_rechargeIncome;
+    Money m_refundAmount;
+    Money m_netIncome;
     int m_currentYear{0};
     int m_currentMonth{0};
     bool m_hasBillingData{false};
@@ -29,7 +29,8 @@ namespace
         BeginRole,
         EndRole,
         MinutesRole,
-        NameRole
+        NameRole,
+        SpanFlagsRole
     };
 
     enum class ScopeFilter
@@ -38,6 +39,26 @@ namespace
         CrossMonth,
         CrossYear
     };
+
+    // 会话跨越自然月 / 自然年的标记位，填充模型时预先算好存入 SpanFlagsRole，筛选时只做位判断
+    enum SessionSpanFlag : quint8
+    {
+        SpanNone = 0,
+        SpanCrossMonth = 1 << 0,
+        SpanCrossYear = 1 << 1
+    };
+
+    quint8 spanFlags(const Session &session)
+    {
+        const QDate begin = session.begin.date();
+        const QDate end = session.end.date();
+        quint8 flags = SpanNone;
+        if (begin.year() != end.year())
+            flags |= SpanCrossMonth | SpanCrossYear;
+        else if (begin.month() != end.month())
+            flags |= SpanCrossMonth;
+        return flags;
+    }
 } // namespace
 
 class SessionsFilterProxyModel : public QSortFilterProxyModel
@@ -69,19 +90,19 @@ public:
 protected:
     bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const override
     {
-        const auto begin = sourceModel()->index(sourceRow, 2, sourceParent).data(BeginRole).toDateTime();
-        const auto end = sourceModel()->index(sourceRow, 3, sourceParent).data(EndRole).toDateTime();
+        // 跨月 / 跨年标记在填充模型时已按 spanFlags 算好
+        const auto flags = sourceModel()->index(sourceRow, 0, sourceParent).data(SpanFlagsRole).toUInt();
 
         switch (m_scopeFilter)
         {
         case ScopeFilter::All:
             break;
         case ScopeFilter::CrossMonth:
-            if (begin.date().year() == end.date().year() && begin.date().month() == end.date().month())
+            if ((flags & SpanCrossMonth) == 0)
                 return false;
             break;
         case ScopeFilter::CrossYear:
-            if (begin.date().year() == end.date().year())
+            if ((flags & SpanCrossYear) == 0)
                 return false;
             break;
         }
@@ -241,6 +262,7 @@ void SessionsPage::setSessions(const std::vector<Session> &sessions, const QHash
         accountItem->setEditable(false);
         accountItem->setData(session.account, AccountRole);
         accountItem->setData(name, NameRole);
+        accountItem->setData(static_cast<uint>(spanFlags(session)), SpanFlagsRole);
         accountItem->setData(session.account, Qt::UserRole);
         m_model->setItem(row, 0, accountItem);
 
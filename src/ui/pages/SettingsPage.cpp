@@ -1,6 +1,7 @@
 #include "ui/pages/SettingsPage.h"
 
 #include "ElaPushButton.h"
+#include "ElaSpinBox.h"
 #include "ElaText.h"
 #include "ElaToggleSwitch.h"
 
@@ -12,6 +13,9 @@
 
 namespace
 {
+    // 备份默认的 zlib 压缩级别，CSV 在该级别下已有接近最高级别的压缩比
+    constexpr int kDefaultBackupCompressionLevel = 6;
+
     QWidget *createOptionRow(const QString &title,
                              const QString &description,
                              ElaToggleSwitch **outSwitch,
@@ -119,10 +123,25 @@ SettingsPage::SettingsPage(QWidget *parent)
     configureActionButton(m_backupButton);
     backupLayout->addWidget(m_backupButton);
 
+    auto *compressionLabel = new ElaText(QStringLiteral(u"压缩级别"), m_backupRow);
+    compressionLabel->setTextStyle(ElaTextType::Body);
+    backupLayout->addWidget(compressionLabel, 0, Qt::AlignVCenter);
+
+    m_compressionLevelSpin = new ElaSpinBox(m_backupRow);
+    m_compressionLevelSpin->setRange(1, 9);
+    m_compressionLevelSpin->setValue(kDefaultBackupCompressionLevel);
+    m_compressionLevelSpin->setToolTip(QStringLiteral(u"级别越高备份越小、导出越慢；导出时选择不压缩的格式则忽略此项"));
+    backupLayout->addWidget(m_compressionLevelSpin, 0, Qt::AlignVCenter);
+
     m_restoreButton = new ElaPushButton(QStringLiteral(u"导入数据备份"), m_backupRow);
     configureActionButton(m_restoreButton);
     backupLayout->addWidget(m_restoreButton);
 
+    m_partitionButton = new ElaPushButton(QStringLiteral(u"按月分区存储上网记录"), m_backupRow);
+    m_partitionButton->setToolTip(QStringLiteral(u"上网记录按月份分文件保存，启动时只加载近两年的记录"));
+    configureActionButton(m_partitionButton);
+    backupLayout->addWidget(m_partitionButton);
+
     layout->addWidget(m_backupRow);
     m_backupRow->setVisible(false);
 
@@ -136,6 +155,7 @@ SettingsPage::SettingsPage(QWidget *parent)
     connect(m_switchAccountButton, &ElaPushButton::clicked, this, &SettingsPage::switchAccountRequested);
     connect(m_backupButton, &ElaPushButton::clicked, this, &SettingsPage::backupRequested);
     connect(m_restoreButton, &ElaPushButton::clicked, this, &SettingsPage::restoreRequested);
+    connect(m_partitionButton, &ElaPushButton::clicked, this, &SettingsPage::partitionSessionsRequested);
 }
 
 void SettingsPage::setDarkModeChecked(bool checked)
@@ -163,3 +183,16 @@ void SettingsPage::setDataManagementVisible(bool visible)
     if (m_restoreButton)
         m_restoreButton->setEnabled(visible);
 }
+
+int SettingsPage::backupCompressionLevel() const
+{
+    return m_compressionLevelSpin ? m_compressionLevelSpin->value() : kDefaultBackupCompressionLevel;
+}
+
+void SettingsPage::setSessionsPartitioned(bool partitioned)
+{
+    if (!m_partitionButton)
+        return;
+    m_partitionButton->setText(partitioned ? QStringLiteral(u"上网记录已按月分区") : QStringLiteral(u"按月分区存储上网记录"));
+    m_partitionButton->setEnabled(!partitioned);
+}
@@ -4,6 +4,7 @@
 
 class ElaToggleSwitch;
 class ElaPushButton;
+class ElaSpinBox;
 
 class SettingsPage : public BasePage
 {
@@ -22,9 +23,13 @@ Q_SIGNALS:
     void switchAccountRequested();
     void backupRequested();
     void restoreRequested();
+    void partitionSessionsRequested();
 
 public:
     void setDataManagementVisible(bool visible);
+    void setSessionsPartitioned(bool partitioned);
+    // 压缩备份使用的 zlib 级别（1–9），选择不压缩的备份格式时不使用
+    int backupCompressionLevel() const;
 
 private:
     ElaToggleSwitch *m_darkModeSwitch{nullptr};
@@ -34,4 +39,6 @@ private:
     QWidget *m_backupRow{nullptr};
     ElaPushButton *m_backupButton{nullptr};
     ElaPushButton *m_restoreButton{nullptr};
+    ElaSpinBox *m_compressionLevelSpin{nullptr};
+    ElaPushButton *m_partitionButton{nullptr};
 };
@@ -4,6 +4,7 @@
 #include "ElaLineEdit.h"
 #include "ElaPushButton.h"
 #include "ElaTableView.h"
+#include "backend/Billing.h"
 #include "backend/Models.h"
 #include "ui/ThemeUtils.h"
 
@@ -22,24 +23,6 @@
 
 namespace
 {
-    QString planToText(Tariff plan)
-    {
-        switch (plan)
-        {
-        case Tariff::NoDiscount:
-            return QStringLiteral(u"标准计费");
-        case Tariff::Pack30h:
-            return QStringLiteral(u"30 小时套餐");
-        case Tariff::Pack60h:
-            return QStringLiteral(u"60 小时套餐");
-        case Tariff::Pack150h:
-            return QStringLiteral(u"150 小时套餐");
-        case Tariff::Unlimited:
-            return QStringLiteral(u"包月不限时");
-        }
-        return QStringLiteral(u"未知套餐");
-    }
-
     QString roleToText(UserRole role)
     {
         switch (role)
@@ -135,16 +118,11 @@ void UsersPage::setupToolbar()
     m_planFilterCombo = new ElaComboBox(this);
     m_planFilterCombo->addItem(QStringLiteral(u"全部套餐"), QVariant::fromValue(-1));
     m_planFilterCombo->setItemData(0, QStringLiteral(u"显示所有套餐类型"), Qt::ToolTipRole);
-    const auto appendPlanFilterOption = [](ElaComboBox *combo, Tariff plan, const QString &text)
+    for (const auto &plan : BillingEngine::tariffs().plans())
     {
-        combo->addItem(text, QVariant::fromValue(static_cast<int>(plan)));
-        combo->setItemData(combo->count() - 1, tariffBillingDescription(plan), Qt::ToolTipRole);
-    };
-    appendPlanFilterOption(m_planFilterCombo, Tariff::NoDiscount, QStringLiteral(u"标准计费"));
-    appendPlanFilterOption(m_planFilterCombo, Tariff::Pack30h, QStringLiteral(u"30 小时套餐"));
-    appendPlanFilterOption(m_planFilterCombo, Tariff::Pack60h, QStringLiteral(u"60 小时套餐"));
-    appendPlanFilterOption(m_planFilterCombo, Tariff::Pack150h, QStringLiteral(u"150 小时套餐"));
-    appendPlanFilterOption(m_planFilterCombo, Tariff::Unlimited, QStringLiteral(u"包月不限时"));
+        m_planFilterCombo->addItem(plan.name, QVariant::fromValue(plan.id));
+        m_planFilterCombo->setItemData(m_planFilterCombo->count() - 1, plan.description, Qt::ToolTipRole);
+    }
     m_planFilterCombo->setCurrentIndex(0);
 
     m_addButton = new ElaPushButton(QStringLiteral(u"新增"), this);
@@ -239,7 +217,7 @@ void UsersPage::setUsers(const std::vector<User> &users)
         nameItem->setData(user.name, Qt::UserRole);
         m_model->setItem(row, 1, nameItem);
 
-        auto *planItem = new QStandardItem(planToText(user.plan));
+        auto *planItem = new QStandardItem(BillingEngine::tariffs().name(static_cast<int>(user.plan)));
         planItem->setData(static_cast<int>(user.plan), Qt::UserRole);
         planItem->setEditable(false);
         m_model->setItem(row, 2, planItem);
@@ -258,12 +236,12 @@ void UsersPage::setUsers(const std::vector<User> &users)
         statusItem->setData(user.enabled ? 1 : 0, Qt::UserRole);
         m_model->setItem(row, 4, statusItem);
 
-        const QString balanceText = locale.toString(user.balance, 'f', 2);
+        const QString balanceText = locale.toString(user.balance.toYuan(), 'f', 2);
         auto *balanceItem = new QStandardItem(balanceText);
         balanceItem->setEditable(false);
-        if (user.balance < 0)
+        if (user.balance < Money())
             balanceItem->setForeground(QBrush(Qt::red));
-        balanceItem->setData(user.balance, Qt::UserRole);
+        balanceItem->setData(user.balance.toYuan(), Qt::UserRole);
         m_model->setItem(row, 5, balanceItem);
     }
 